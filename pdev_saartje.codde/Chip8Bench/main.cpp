@@ -0,0 +1,476 @@
+// Chip8Bench: runs every ROM through every execution core for a fixed number of instructions and reports the speed
+//
+// Usage: Chip8Bench [options] [ROM names]
+//   --roms <dir>         Directory of the ROMs (default ../c8games), the names default to all the games shipped in it
+//   --instructions N     Emulated instructions per run (default 1000000)
+//   --ips N              Instructions per second of emulated time, sets the frame length (default 500)
+//   --repetitions N      Measured runs per ROM and core (default 5)
+//   --warmup N           Runs before the measured ones (default 1)
+//   --core C             switch|threaded|jit|static, repeat to measure several, all of them by default
+//   --quirks Q           rom|default|connect4|blitz|vip, repeat to run several; rom is the profile the ROM's checksum
+//                        picks. By default rom and vip, which makes the static core fall back to the interpreter
+//   --json <file>        Also write the results as JSON, - for stdout
+//   --counters           Also count cycles, host instructions, branch and L1d misses of the measured runs (Linux),
+//                        per emulated instruction and per frame; software counters where the PMU is not available
+//
+// A run is what the emulator thread does: frames of instructions followed by a timer tick and Draw(), with a fixed
+// pattern of keypresses so that games get past their title screen. Every run starts from the same state and random seed,
+// so all cores must end in the same state (Chip8::GetStateHash()); a core that does not is reported as a mismatch.
+// The static core only runs ROMs that generated code is built in for (RecompiledPONG.cpp and Recompiled15PUZZLE.cpp come
+// with the projects, Chip8Recompiler makes more); when the ROM writes into its code the interpreter takes over, that is
+// reported after the result
+
+#define _CRT_SECURE_NO_WARNINGS // fopen, the tool is also built outside of Visual Studio
+
+#include "Chip8.h"
+#include "Chip8PerfCounters.h"
+#include "Chip8Scheduler.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char *defaultRoms[] =
+	{
+		"15PUZZLE", "BLINKY", "BLITZ", "BRIX", "CONNECT4", "GUESS", "HIDDEN", "IBM", "INVADERS", "KALEID", "MAZE", "MERLIN", "MISSILE",
+		"PONG", "PONG2", "PUZZLE", "SAARTJE", "SYZYGY", "TANK", "TETRIS", "TICTAC", "UFO", "VBRIX", "VERS", "WIPEOFF"
+	};
+
+	struct CoreName
+	{
+		Chip8::Core core;
+		const char *name;
+	};
+	const CoreName cores[] =
+	{
+		{ Chip8::CORE_SWITCH, "switch" },
+		{ Chip8::CORE_THREADED, "threaded" },
+		{ Chip8::CORE_JIT, "jit" },
+		{ Chip8::CORE_STATIC, "static" }
+	};
+
+	struct QuirksName
+	{
+		int profile; // Chip8::QuirkProfile, -1 for the one the ROM picks
+		const char *name;
+	};
+	const QuirksName quirkProfiles[] =
+	{
+		{ -1, "rom" },
+		{ Chip8::QUIRKS_DEFAULT, "default" },
+		{ Chip8::QUIRKS_CONNECT4, "connect4" },
+		{ Chip8::QUIRKS_BLITZ, "blitz" },
+		{ Chip8::QUIRKS_VIP, "vip" }
+	};
+
+	const int keyPeriod = 37; // Frames between keypresses, a different key each time
+	const int keyHold = 5; // Frames a key stays down
+
+	struct Settings
+	{
+		long long instructions = 1000000;
+		int ips = 500;
+		int repetitions = 5;
+		int warmup = 1;
+		bool counters = false;
+	};
+
+	// Outcome of one run
+	struct Pass
+	{
+		long long instructions = 0; // Executed, fewer than requested when draws end frames early (displayWait)
+		long long dxyn = 0;
+		long long frames = 0;
+		unsigned long long displayHash = 0;
+		U64 stateHash = 0;
+		double seconds = 0;
+		bool loaded = false;
+		bool recompiled = false; // Generated code for the ROM was still in use at the end
+	};
+
+	struct Result
+	{
+		std::string rom;
+		const char *core;
+		const char *quirks;
+		Pass counted;
+		std::vector<double> nsPerInstruction;
+		double meanNs = 0, minNs = 0, maxNs = 0, stddevNs = 0;
+		double mips = 0, framesPerSecond = 0;
+		bool mismatch = false;
+		bool recompiled = false;
+		long long counterTotals[Chip8PerfCounters::COUNTER_COUNT] = {}; // Over all measured runs
+	};
+
+	unsigned long long DisplayHash(const Chip8 &chip8)
+	{
+		// FNV-1a over the rows, most significant byte first
+		unsigned long long hash = 14695981039346656037ULL;
+		const U64 *display = chip8.GetDisplay();
+		for (int row = 0; row < 32; row++)
+		{
+			for (int byte = 7; byte >= 0; byte--)
+			{
+				hash ^= (display[row] >> (byte * 8)) & 0xFF;
+				hash *= 1099511628211ULL;
+			}
+		}
+		return hash;
+	}
+
+	// One run of the workload; counting steps one instruction at a time to count what executes, and is not timed
+	// counters, when given, count during the timed part
+	Pass RunPass(const std::string &path, Chip8::Core core, const QuirksName &quirks, const Settings &settings, bool counting, Chip8PerfCounters *counters = nullptr)
+	{
+		Pass pass;
+		std::unique_ptr<Chip8> chip8(new Chip8);
+		chip8->SetCore(core);
+		if (quirks.profile >= 0)
+		{
+			chip8->SetQuirkProfile((Chip8::QuirkProfile)quirks.profile);
+		}
+		if (!chip8->Initialize(path.c_str()))
+		{
+			return pass;
+		}
+		pass.loaded = true;
+
+		Chip8Scheduler scheduler(*chip8);
+		scheduler.SetInstructionsPerSecond(settings.ips);
+		const U8 *memory = chip8->GetMemory();
+
+		typedef std::chrono::steady_clock Clock;
+		if (counters) counters->Start();
+		Clock::time_point start = Clock::now();
+
+		long long left = settings.instructions;
+		while (left > 0)
+		{
+			if (pass.frames % keyPeriod == 0) chip8->SetKey((pass.frames / keyPeriod) % 16, true);
+			if (pass.frames % keyPeriod == keyHold) chip8->SetKey((pass.frames / keyPeriod) % 16, false);
+
+			int count = scheduler.NextFrameInstructions();
+			if (count > left)
+			{
+				count = (int)left;
+			}
+			if (counting)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					bool draw = (memory[chip8->GetPC() & 0x0FFF] >> 4) == 0xD;
+					chip8->Run(1);
+					pass.instructions++;
+					pass.dxyn += draw;
+					if (chip8->IsWaitingForFrame())
+					{
+						break;
+					}
+				}
+			}
+			else
+			{
+				chip8->Run(count);
+			}
+			left -= count;
+			scheduler.TickTimers();
+			chip8->Draw();
+			pass.frames++;
+		}
+
+		pass.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (counters) counters->Stop();
+		pass.displayHash = DisplayHash(*chip8);
+		pass.stateHash = chip8->GetStateHash();
+		pass.recompiled = chip8->HasRecompiledProgram();
+		return pass;
+	}
+
+	void Measure(Result &result, const std::string &path, Chip8::Core core, const QuirksName &quirks, const Settings &settings, Chip8PerfCounters *counters)
+	{
+		for (int i = 0; i < settings.warmup; i++)
+		{
+			RunPass(path, core, quirks, settings, false);
+		}
+
+		if (counters) counters->Reset();
+		double total = 0, seconds = 0;
+		for (int i = 0; i < settings.repetitions; i++)
+		{
+			Pass pass = RunPass(path, core, quirks, settings, false, counters);
+			if (pass.displayHash != result.counted.displayHash || pass.stateHash != result.counted.stateHash)
+			{
+				result.mismatch = true;
+			}
+			result.recompiled = pass.recompiled;
+			double ns = pass.seconds * 1e9 / (result.counted.instructions > 0 ? result.counted.instructions : 1);
+			result.nsPerInstruction.push_back(ns);
+			total += ns;
+			seconds += pass.seconds;
+		}
+
+		int n = settings.repetitions;
+		result.meanNs = total / n;
+		result.minNs = result.maxNs = result.nsPerInstruction[0];
+		double squares = 0;
+		for (double ns : result.nsPerInstruction)
+		{
+			if (ns < result.minNs) result.minNs = ns;
+			if (ns > result.maxNs) result.maxNs = ns;
+			squares += (ns - result.meanNs) * (ns - result.meanNs);
+		}
+		result.stddevNs = n > 1 ? sqrt(squares / (n - 1)) : 0;
+		result.mips = result.meanNs > 0 ? 1e3 / result.meanNs : 0;
+		result.framesPerSecond = seconds > 0 ? result.counted.frames * n / seconds : 0;
+
+		for (int i = 0; counters && i < Chip8PerfCounters::COUNTER_COUNT; i++)
+		{
+			result.counterTotals[i] = counters->Get((Chip8PerfCounters::Counter)i);
+		}
+	}
+
+	// Counter totals of a result divided by the instructions or the frames of all its measured runs
+	double PerRun(const Result &result, int counter, long long perRun, const Settings &settings)
+	{
+		return perRun > 0 ? (double)result.counterTotals[counter] / ((double)perRun * settings.repetitions) : 0.0;
+	}
+
+	void WriteCounters(FILE *out, const Result &result, const Chip8PerfCounters &counters, const Settings &settings, long long perRun)
+	{
+		bool first = true;
+		for (int i = 0; i < Chip8PerfCounters::COUNTER_COUNT; i++)
+		{
+			if (!counters.IsAvailable((Chip8PerfCounters::Counter)i)) continue;
+			fprintf(out, "%s\"%s\": %.4f", first ? "" : ", ", Chip8PerfCounters::Name((Chip8PerfCounters::Counter)i), PerRun(result, i, perRun, settings));
+			first = false;
+		}
+	}
+
+	void WriteJson(FILE *out, const Settings &settings, const std::vector<Result> &results, const Chip8PerfCounters *counters)
+	{
+		fprintf(out, "{\n");
+		fprintf(out, "  \"instructions\": %lld,\n", settings.instructions);
+		fprintf(out, "  \"ips\": %d,\n", settings.ips);
+		fprintf(out, "  \"repetitions\": %d,\n", settings.repetitions);
+		fprintf(out, "  \"warmup\": %d,\n", settings.warmup);
+		if (counters)
+		{
+			fprintf(out, "  \"counter_source\": \"%s\",\n", counters->GetSource());
+		}
+		fprintf(out, "  \"results\": [\n");
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const Result &r = results[i];
+			fprintf(out, "    {\n");
+			fprintf(out, "      \"rom\": \"%s\",\n", r.rom.c_str());
+			fprintf(out, "      \"core\": \"%s\",\n", r.core);
+			fprintf(out, "      \"quirks\": \"%s\",\n", r.quirks);
+			fprintf(out, "      \"instructions\": %lld,\n", r.counted.instructions);
+			fprintf(out, "      \"frames\": %lld,\n", r.counted.frames);
+			fprintf(out, "      \"dxyn\": %lld,\n", r.counted.dxyn);
+			fprintf(out, "      \"dxyn_share\": %.6f,\n", r.counted.instructions > 0 ? (double)r.counted.dxyn / r.counted.instructions : 0.0);
+			fprintf(out, "      \"display_hash\": \"%016llx\",\n", r.counted.displayHash);
+			fprintf(out, "      \"state_hash\": \"%016llx\",\n", r.counted.stateHash);
+			fprintf(out, "      \"mismatch\": %s,\n", r.mismatch ? "true" : "false");
+			fprintf(out, "      \"mips\": %.3f,\n", r.mips);
+			fprintf(out, "      \"frames_per_second\": %.1f,\n", r.framesPerSecond);
+			fprintf(out, "      \"ns_per_instruction\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"stddev\": %.4f, \"variance\": %.6f, \"samples\": [",
+				r.meanNs, r.minNs, r.maxNs, r.stddevNs, r.stddevNs * r.stddevNs);
+			for (size_t j = 0; j < r.nsPerInstruction.size(); j++)
+			{
+				fprintf(out, "%s%.4f", j ? ", " : "", r.nsPerInstruction[j]);
+			}
+			fprintf(out, "] }%s\n", counters ? "," : "");
+			if (counters)
+			{
+				fprintf(out, "      \"counters_per_instruction\": { ");
+				WriteCounters(out, r, *counters, settings, r.counted.instructions);
+				fprintf(out, " },\n");
+				fprintf(out, "      \"counters_per_frame\": { ");
+				WriteCounters(out, r, *counters, settings, r.counted.frames);
+				fprintf(out, " }\n");
+			}
+			fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n");
+		fprintf(out, "}\n");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	Settings settings;
+	std::string romDirectory = "../c8games";
+	std::vector<std::string> roms;
+	std::vector<const CoreName *> selected;
+	std::vector<const QuirksName *> profiles;
+	const char *jsonPath = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--roms") == 0 && hasValue) romDirectory = argv[++i];
+		else if (strcmp(argv[i], "--instructions") == 0 && hasValue) settings.instructions = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--ips") == 0 && hasValue) settings.ips = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--repetitions") == 0 && hasValue) settings.repetitions = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--warmup") == 0 && hasValue) settings.warmup = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--json") == 0 && hasValue) jsonPath = argv[++i];
+		else if (strcmp(argv[i], "--counters") == 0) settings.counters = true;
+		else if (strcmp(argv[i], "--core") == 0 && hasValue)
+		{
+			++i;
+			const CoreName *found = nullptr;
+			for (const CoreName &core : cores)
+			{
+				if (strcmp(argv[i], core.name) == 0) found = &core;
+			}
+			if (found == nullptr)
+			{
+				fprintf(stderr, "Unknown core %s\n", argv[i]);
+				return 2;
+			}
+			selected.push_back(found);
+		}
+		else if (strcmp(argv[i], "--quirks") == 0 && hasValue)
+		{
+			++i;
+			const QuirksName *found = nullptr;
+			for (const QuirksName &quirks : quirkProfiles)
+			{
+				if (strcmp(argv[i], quirks.name) == 0) found = &quirks;
+			}
+			if (found == nullptr)
+			{
+				fprintf(stderr, "Unknown quirk profile %s\n", argv[i]);
+				return 2;
+			}
+			profiles.push_back(found);
+		}
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 2;
+		}
+		else roms.push_back(argv[i]);
+	}
+	if (settings.instructions <= 0 || settings.ips <= 0 || settings.repetitions <= 0 || settings.warmup < 0)
+	{
+		fprintf(stderr, "--instructions, --ips and --repetitions must be at least 1\n");
+		return 2;
+	}
+	if (roms.empty())
+	{
+		roms.assign(defaultRoms, defaultRoms + sizeof(defaultRoms) / sizeof(defaultRoms[0]));
+	}
+	if (selected.empty())
+	{
+		for (const CoreName &core : cores) selected.push_back(&core);
+	}
+	if (profiles.empty())
+	{
+		profiles.push_back(&quirkProfiles[0]);
+		profiles.push_back(&quirkProfiles[4]);
+	}
+
+	Chip8PerfCounters perfCounters;
+	Chip8PerfCounters *counters = nullptr;
+	if (settings.counters)
+	{
+		if (!perfCounters.Open())
+		{
+			fprintf(stderr, "No performance counters on this platform\n");
+			return 2;
+		}
+		counters = &perfCounters;
+	}
+
+	// The JSON goes to stdout on its own, the table then goes to stderr
+	FILE *table = jsonPath && strcmp(jsonPath, "-") == 0 ? stderr : stdout;
+	fprintf(table, "%-10s %-9s %-8s %12s %10s %16s %12s %7s\n", "ROM", "core", "quirks", "instructions", "MIPS", "ns/instruction", "frames/s", "DXYN");
+	if (counters && !counters->HasHardwareCounters())
+	{
+		fprintf(table, "No access to the hardware counters, only software counters from %s\n", counters->GetSource());
+	}
+
+	std::vector<Result> results;
+	bool failed = false;
+	for (const std::string &rom : roms)
+	{
+		for (const QuirksName *quirks : profiles)
+		{
+			std::string path = romDirectory + "/" + rom;
+
+			// The same for every core, they all execute exactly the same instructions
+			Pass counted = RunPass(path, Chip8::CORE_SWITCH, *quirks, settings, true);
+			if (!counted.loaded)
+			{
+				fprintf(stderr, "Could not load %s\n", path.c_str());
+				failed = true;
+				continue;
+			}
+
+			for (const CoreName *core : selected)
+			{
+				if (core->core == Chip8::CORE_STATIC)
+				{
+					Chip8 probe;
+					probe.Initialize(path.c_str());
+					if (!probe.HasRecompiledProgram())
+					{
+						continue; // Would only measure the switch core again
+					}
+				}
+
+				Result result;
+				result.rom = rom;
+				result.core = core->name;
+				result.quirks = quirks->name;
+				result.counted = counted;
+				Measure(result, path, core->core, *quirks, settings, counters);
+				results.push_back(result);
+
+				fprintf(table, "%-10s %-9s %-8s %12lld %10.2f %8.3f +-%5.3f %12.0f %6.2f%%%s%s\n", rom.c_str(), core->name, quirks->name, counted.instructions,
+					result.mips, result.meanNs, result.stddevNs, result.framesPerSecond,
+					counted.instructions > 0 ? 100.0 * counted.dxyn / counted.instructions : 0.0, result.mismatch ? "  MISMATCH" : "",
+					core->core == Chip8::CORE_STATIC && !result.recompiled ? "  (the ROM wrote into its code, interpreted from then on)" : "");
+				failed |= result.mismatch;
+
+				if (counters)
+				{
+					// Per emulated instruction, then per frame
+					fprintf(table, "%-29s", "");
+					for (int i = 0; i < Chip8PerfCounters::COUNTER_COUNT; i++)
+					{
+						if (!counters->IsAvailable((Chip8PerfCounters::Counter)i)) continue;
+						fprintf(table, " %s %.3f/%.1f", Chip8PerfCounters::Name((Chip8PerfCounters::Counter)i),
+							PerRun(result, i, counted.instructions, settings), PerRun(result, i, counted.frames, settings));
+					}
+					fprintf(table, "\n");
+				}
+			}
+		}
+	}
+
+	if (jsonPath)
+	{
+		FILE *out = strcmp(jsonPath, "-") == 0 ? stdout : fopen(jsonPath, "w");
+		if (out == NULL)
+		{
+			fprintf(stderr, "Could not write %s\n", jsonPath);
+			return 1;
+		}
+		WriteJson(out, settings, results, counters);
+		if (out != stdout)
+		{
+			fclose(out);
+		}
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,315 @@
+// Chip8Check: self-tests of the snapshot tools of PDevEmulator, runs every ROM through every core and checks them on the way
+//
+// Usage: Chip8Check [options] [ROM names]
+//   --roms <dir>         Directory of the ROMs (default ../c8games), the names default to all the games shipped in it
+//   --frames N           Frames per run (default 2000)
+//   --ips N              Instructions per second of emulated time (default 500)
+//   --core C             switch|threaded|jit|static, repeat to check several, all of them by default
+//   --quirks Q           rom|default|connect4|blitz|vip, repeat to check several; rom is the profile the ROM's checksum
+//                        picks. By default rom and vip
+//   --rewind-bytes N     Size of the rewind ring (default 16384), small so that it wraps often
+//
+// rewind: every frame is recorded in a rewind ring (Chip8Rewind.h) with a keyframe every 10 frames, and after every frame
+//         every age still in it is decoded and compared with the state saved back then; every 13 frames it also steps
+//         back one frame, so the run ends elsewhere
+// fork:   at the end the final state branches on every key for 10 frames, twice with forks (Chip8Fork.h) and once with
+//         savestates; every child must match its savestate and load back to it
+//
+// Runs press keys in the same pattern as Chip8Bench. Prints one line per ROM, profile and core and the differences found,
+// exit code 1 when a check fails or a ROM could not be loaded
+
+#define _CRT_SECURE_NO_WARNINGS // fopen, the tool is also built outside of Visual Studio
+
+#include "Chip8.h"
+#include "Chip8Fork.h"
+#include "Chip8Rewind.h"
+#include "Chip8Scheduler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char *defaultRoms[] =
+	{
+		"15PUZZLE", "BLINKY", "BLITZ", "BRIX", "CONNECT4", "GUESS", "HIDDEN", "IBM", "INVADERS", "KALEID", "MAZE", "MERLIN", "MISSILE",
+		"PONG", "PONG2", "PUZZLE", "SAARTJE", "SYZYGY", "TANK", "TETRIS", "TICTAC", "UFO", "VBRIX", "VERS", "WIPEOFF"
+	};
+
+	struct CoreName
+	{
+		Chip8::Core core;
+		const char *name;
+	};
+	const CoreName cores[] =
+	{
+		{ Chip8::CORE_SWITCH, "switch" },
+		{ Chip8::CORE_THREADED, "threaded" },
+		{ Chip8::CORE_JIT, "jit" },
+		{ Chip8::CORE_STATIC, "static" }
+	};
+
+	struct QuirksName
+	{
+		int profile; // Chip8::QuirkProfile, -1 for the one the ROM picks
+		const char *name;
+	};
+	const QuirksName quirkProfiles[] =
+	{
+		{ -1, "rom" },
+		{ Chip8::QUIRKS_DEFAULT, "default" },
+		{ Chip8::QUIRKS_CONNECT4, "connect4" },
+		{ Chip8::QUIRKS_BLITZ, "blitz" },
+		{ Chip8::QUIRKS_VIP, "vip" }
+	};
+
+	const int keyPeriod = 37; // Frames between keypresses, a different key each time
+	const int keyHold = 5; // Frames a key stays down
+
+	struct Settings
+	{
+		long long frames = 2000;
+		int ips = 500;
+		int rewindBytes = 16384;
+	};
+
+	// Records the frame that just ran and checks that every frame in the ring decodes to the state it was recorded from
+	// history holds those states, the last one is the frame just run
+	bool CheckRewind(Chip8 &chip8, Chip8Rewind &rewind, std::deque<Chip8State> &history, long long frame)
+	{
+		rewind.Record(chip8);
+		history.emplace_back();
+		chip8.SaveState(history.back());
+
+		if (frame % 13 == 0 && rewind.GetFrameCount() >= 2)
+		{
+			history.pop_back();
+			Chip8State state;
+			if (!rewind.StepBack(chip8)) return false;
+			chip8.SaveState(state);
+			if (memcmp(&state, &history.back(), sizeof(Chip8State)) != 0)
+			{
+				fprintf(stderr, "Rewind: stepping back after frame %lld does not give the frame before\n", frame);
+				return false;
+			}
+		}
+
+		if (rewind.GetFrameCount() > (int)history.size())
+		{
+			fprintf(stderr, "Rewind: %d frames after frame %lld, only %zu recorded\n", rewind.GetFrameCount(), frame, history.size());
+			return false;
+		}
+		history.erase(history.begin(), history.end() - rewind.GetFrameCount());
+
+		for (int age = 0; age < rewind.GetFrameCount(); age++)
+		{
+			Chip8State state;
+			if (!rewind.GetState(age, state) || memcmp(&state, &history[history.size() - 1 - age], sizeof(Chip8State)) != 0)
+			{
+				fprintf(stderr, "Rewind: %d frames back from frame %lld does not decode to its state\n", age, frame);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Runs every key from the current state through forks and through savestates and compares the results
+	// The machine is back in the current state afterwards
+	bool CheckForks(Chip8 &chip8, Chip8Scheduler &scheduler)
+	{
+		const int frames = 10;
+		static Chip8State start, expected[16];
+		chip8.SaveState(start);
+		Chip8Fork parent;
+		chip8.SaveFork(parent);
+
+		for (int key = 0; key < 16; key++)
+		{
+			chip8.LoadState(start);
+			chip8.SetKey(key, true);
+			scheduler.RunAhead(frames);
+			chip8.SetKey(key, false);
+			chip8.SaveState(expected[key]);
+		}
+
+		// The second round loads the parent after machines that already wrote the chunks of the first
+		Chip8Fork children[16];
+		for (int round = 0; round < 2; round++)
+		{
+			for (int key = 0; key < 16; key++)
+			{
+				chip8.LoadFork(parent);
+				chip8.SetKey(key, true);
+				scheduler.RunAhead(frames);
+				chip8.SetKey(key, false);
+				chip8.SaveFork(children[key]);
+			}
+		}
+
+		bool same = true;
+		for (int key = 0; key < 16; key++)
+		{
+			Chip8State state;
+			children[key].GetState(state);
+			if (memcmp(&state, &expected[key], sizeof(Chip8State)) != 0)
+			{
+				fprintf(stderr, "Fork: the child of key %X differs from its savestate\n", key);
+				same = false;
+			}
+			chip8.LoadFork(children[key]);
+			chip8.SaveState(state);
+			if (memcmp(&state, &expected[key], sizeof(Chip8State)) != 0)
+			{
+				fprintf(stderr, "Fork: loading the child of key %X does not give its savestate\n", key);
+				same = false;
+			}
+		}
+		chip8.LoadState(start);
+		return same;
+	}
+
+	// Outcome of the checks of one run
+	struct Run
+	{
+		bool loaded = false;
+		bool rewind = true;
+		bool fork = true;
+	};
+
+	Run RunChecks(const std::string &path, Chip8::Core core, const QuirksName &quirks, const Settings &settings)
+	{
+		Run run;
+		std::unique_ptr<Chip8> chip8(new Chip8); // 32 KB of decoded instructions, keep it off the stack
+		chip8->SetCore(core);
+		if (quirks.profile >= 0)
+		{
+			chip8->SetQuirkProfile((Chip8::QuirkProfile)quirks.profile);
+		}
+		if (!chip8->Initialize(path.c_str()))
+		{
+			return run;
+		}
+		run.loaded = true;
+
+		Chip8Scheduler scheduler(*chip8);
+		scheduler.SetInstructionsPerSecond(settings.ips);
+		Chip8Rewind rewind(settings.rewindBytes, 10);
+		std::deque<Chip8State> history;
+
+		for (long long frame = 0; frame < settings.frames && run.rewind;)
+		{
+			if (frame % keyPeriod == 0) chip8->SetKey((frame / keyPeriod) % 16, true);
+			if (frame % keyPeriod == keyHold) chip8->SetKey((frame / keyPeriod) % 16, false);
+
+			chip8->Run(scheduler.NextFrameInstructions());
+			scheduler.TickTimers();
+			frame++;
+
+			run.rewind = CheckRewind(*chip8, rewind, history, frame);
+		}
+		run.fork = CheckForks(*chip8, scheduler);
+		return run;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	Settings settings;
+	std::string romDirectory = "../c8games";
+	std::vector<std::string> roms;
+	std::vector<const CoreName *> selected;
+	std::vector<const QuirksName *> profiles;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--roms") == 0 && hasValue) romDirectory = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0 && hasValue) settings.frames = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--ips") == 0 && hasValue) settings.ips = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--rewind-bytes") == 0 && hasValue) settings.rewindBytes = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--core") == 0 && hasValue)
+		{
+			++i;
+			const CoreName *found = nullptr;
+			for (const CoreName &core : cores)
+			{
+				if (strcmp(argv[i], core.name) == 0) found = &core;
+			}
+			if (found == nullptr)
+			{
+				fprintf(stderr, "Unknown core %s\n", argv[i]);
+				return 2;
+			}
+			selected.push_back(found);
+		}
+		else if (strcmp(argv[i], "--quirks") == 0 && hasValue)
+		{
+			++i;
+			const QuirksName *found = nullptr;
+			for (const QuirksName &quirks : quirkProfiles)
+			{
+				if (strcmp(argv[i], quirks.name) == 0) found = &quirks;
+			}
+			if (found == nullptr)
+			{
+				fprintf(stderr, "Unknown quirk profile %s\n", argv[i]);
+				return 2;
+			}
+			profiles.push_back(found);
+		}
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 2;
+		}
+		else roms.push_back(argv[i]);
+	}
+	if (settings.frames <= 0 || settings.ips <= 0 || settings.rewindBytes <= 0)
+	{
+		fprintf(stderr, "--frames, --ips and --rewind-bytes must be at least 1\n");
+		return 2;
+	}
+	if (roms.empty())
+	{
+		roms.assign(defaultRoms, defaultRoms + sizeof(defaultRoms) / sizeof(defaultRoms[0]));
+	}
+	if (selected.empty())
+	{
+		for (const CoreName &core : cores) selected.push_back(&core);
+	}
+	if (profiles.empty())
+	{
+		profiles.push_back(&quirkProfiles[0]);
+		profiles.push_back(&quirkProfiles[4]);
+	}
+
+	printf("%-10s %-9s %-8s %-6s %-6s\n", "ROM", "core", "quirks", "rewind", "fork");
+	fflush(stdout); // The differences go to stderr, each just above the line of its run
+	bool failed = false;
+	for (const std::string &rom : roms)
+	{
+		for (const QuirksName *quirks : profiles)
+		{
+			std::string path = romDirectory + "/" + rom;
+			for (const CoreName *core : selected)
+			{
+				Run run = RunChecks(path, core->core, *quirks, settings);
+				if (!run.loaded)
+				{
+					fprintf(stderr, "Could not load %s\n", path.c_str());
+					failed = true;
+					break;
+				}
+				printf("%-10s %-9s %-8s %-6s %-6s\n", rom.c_str(), core->name, quirks->name, run.rewind ? "ok" : "FAILED", run.fork ? "ok" : "FAILED");
+				fflush(stdout);
+				failed |= !run.rewind || !run.fork;
+			}
+		}
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,422 @@
+// Chip8Headless: runs a ROM without a window, GL context or sound, as fast as possible, and reports the final state
+//
+// Usage: Chip8Headless <rom> [options]
+//   --frames N           Run N frames of 1/60 s (default 600)
+//   --instructions N     Run N instructions instead, the timers still tick once per frame
+//   --ips N              Instructions per second of emulated time (default 500)
+//   --core switch|threaded|jit|static
+//   --quirks default|connect4|blitz|vip
+//   --input <file>       Replay an input script, one "<frame> <key 0-F> down|up" per line, # starts a comment
+//   --screen             Also print the final display
+//   --profile <prefix>   Write <prefix>.folded (flamegraph input), <prefix>.hotspots.csv and <prefix>.opcodes.csv,
+//                        the project defines CHIP8_PROFILE for this
+//   --load <file>        Start from the first snapshot in a savestate file instead of from the start of the ROM
+//   --save <file>        Write the final state as a savestate
+//   --counters           Also print the performance counters of the run (Linux), per emulated instruction and per frame
+//   --run-ahead N        After every frame run N frames ahead and go back with a savestate, like the front end does
+//   --stop-on-cycle      Once the input script is over, compare the state hash at the start of every emulated second;
+//                        when a state comes back the ROM is in a cycle and whole periods of it are skipped
+//   --hashes <file>      Write "<frame> <state hash>" after every frame, for comparing replays
+//   --memo <MB>          Replay the recorded changes of frames that start from a state seen before (Chip8Memo.h)
+//
+// Prints the FNV-1a hash of the final display, the state hash, the registers and the timing,
+// exit code 1 when the ROM could not be loaded
+
+#define _CRT_SECURE_NO_WARNINGS // fopen, the tool is also built outside of Visual Studio
+
+#include "Chip8.h"
+#include "Chip8Memo.h"
+#include "Chip8PerfCounters.h"
+#include "Chip8Profiler.h"
+#include "Chip8Savestate.h"
+#include "Chip8Scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct InputEvent
+{
+	long long frame;
+	U8 key;
+	bool pressed;
+};
+
+bool LoadInputScript(const char *path, std::vector<InputEvent> &events)
+{
+	FILE *script = fopen(path, "r");
+	if (script == NULL) return false;
+
+	char line[256];
+	int lineNumber = 0;
+	while (fgets(line, sizeof(line), script))
+	{
+		lineNumber++;
+		char *comment = strchr(line, '#');
+		if (comment) *comment = 0;
+
+		long long frame;
+		unsigned int key;
+		char state[16];
+		int fields = sscanf(line, "%lld %x %15s", &frame, &key, state);
+		if (fields <= 0) continue; // Empty line
+
+		if (fields != 3 || key > 0xF || (strcmp(state, "down") != 0 && strcmp(state, "up") != 0))
+		{
+			fprintf(stderr, "%s:%d: expected \"<frame> <key 0-F> down|up\"\n", path, lineNumber);
+			fclose(script);
+			return false;
+		}
+		InputEvent event = { frame, (U8)key, strcmp(state, "down") == 0 };
+		events.push_back(event);
+	}
+	fclose(script);
+
+	std::stable_sort(events.begin(), events.end(), [](const InputEvent &a, const InputEvent &b) { return a.frame < b.frame; });
+	return true;
+}
+
+bool WriteProfile(const Chip8Profiler &profiler, const std::string &prefix)
+{
+	struct Output
+	{
+		const char *suffix;
+		void (Chip8Profiler::*write)(FILE *out) const;
+	};
+	const Output outputs[] =
+	{
+		{ ".hotspots.csv", &Chip8Profiler::WriteHotSpots },
+		{ ".opcodes.csv", &Chip8Profiler::WriteOpcodes }
+	};
+
+	FILE *out = fopen((prefix + ".folded").c_str(), "w");
+	if (out == NULL) return false;
+	profiler.WriteFolded(out);
+	fclose(out);
+
+	for (const Output &output : outputs)
+	{
+		out = fopen((prefix + output.suffix).c_str(), "w");
+		if (out == NULL) return false;
+		(profiler.*output.write)(out);
+		fclose(out);
+	}
+	return true;
+}
+
+unsigned long long DisplayHash(const Chip8 &chip8)
+{
+	// FNV-1a over the rows, most significant byte first so the hash does not depend on the host
+	unsigned long long hash = 14695981039346656037ULL;
+	const U64 *display = chip8.GetDisplay();
+	for (int row = 0; row < 32; row++)
+	{
+		for (int byte = 7; byte >= 0; byte--)
+		{
+			hash ^= (display[row] >> (byte * 8)) & 0xFF;
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: Chip8Headless <rom> [--frames N | --instructions N] [--ips N] [--core C] [--quirks Q] [--input file] [--screen] [--run-ahead N] [--stop-on-cycle] [--hashes file] [--memo MB]\n");
+		return 2;
+	}
+
+	const char *romPath = argv[1];
+	long long frames = 600;
+	long long instructions = -1; // Frame budget when negative
+	int ips = 500;
+	const char *inputPath = nullptr;
+	bool screen = false;
+	const char *profilePath = nullptr;
+	bool countersWanted = false;
+	const char *loadPath = nullptr;
+	const char *savePath = nullptr;
+	int runAhead = 0;
+	bool stopOnCycle = false;
+	const char *hashesPath = nullptr;
+	int memoMegabytes = 0;
+
+	static Chip8 chip8; // 32 KB of decoded instructions, keep it off the stack
+
+	for (int i = 2; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--frames") == 0 && hasValue) frames = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--instructions") == 0 && hasValue) instructions = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--ips") == 0 && hasValue) ips = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--input") == 0 && hasValue) inputPath = argv[++i];
+		else if (strcmp(argv[i], "--screen") == 0) screen = true;
+		else if (strcmp(argv[i], "--profile") == 0 && hasValue) profilePath = argv[++i];
+		else if (strcmp(argv[i], "--counters") == 0) countersWanted = true;
+		else if (strcmp(argv[i], "--load") == 0 && hasValue) loadPath = argv[++i];
+		else if (strcmp(argv[i], "--save") == 0 && hasValue) savePath = argv[++i];
+		else if (strcmp(argv[i], "--run-ahead") == 0 && hasValue) runAhead = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--stop-on-cycle") == 0) stopOnCycle = true;
+		else if (strcmp(argv[i], "--hashes") == 0 && hasValue) hashesPath = argv[++i];
+		else if (strcmp(argv[i], "--memo") == 0 && hasValue) memoMegabytes = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--core") == 0 && hasValue)
+		{
+			++i;
+			if (strcmp(argv[i], "threaded") == 0) chip8.SetCore(Chip8::CORE_THREADED);
+			else if (strcmp(argv[i], "jit") == 0) chip8.SetCore(Chip8::CORE_JIT);
+			else if (strcmp(argv[i], "static") == 0) chip8.SetCore(Chip8::CORE_STATIC);
+			else chip8.SetCore(Chip8::CORE_SWITCH);
+		}
+		else if (strcmp(argv[i], "--quirks") == 0 && hasValue)
+		{
+			++i;
+			if (strcmp(argv[i], "connect4") == 0) chip8.SetQuirkProfile(Chip8::QUIRKS_CONNECT4);
+			else if (strcmp(argv[i], "blitz") == 0) chip8.SetQuirkProfile(Chip8::QUIRKS_BLITZ);
+			else if (strcmp(argv[i], "vip") == 0) chip8.SetQuirkProfile(Chip8::QUIRKS_VIP);
+			else chip8.SetQuirkProfile(Chip8::QUIRKS_DEFAULT);
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+	if (ips <= 0)
+	{
+		fprintf(stderr, "--ips must be at least 1\n");
+		return 2;
+	}
+
+	std::vector<InputEvent> events;
+	if (inputPath && !LoadInputScript(inputPath, events))
+	{
+		fprintf(stderr, "Could not read input script %s\n", inputPath);
+		return 1;
+	}
+
+	if (!chip8.Initialize(romPath))
+	{
+		fprintf(stderr, "Could not load %s\n", romPath);
+		return 1;
+	}
+
+#ifdef CHIP8_PROFILE
+	Chip8Profiler profiler;
+	if (profilePath)
+	{
+		chip8.SetProfiler(&profiler);
+	}
+#else
+	if (profilePath)
+	{
+		fprintf(stderr, "--profile needs a build with CHIP8_PROFILE defined\n");
+		return 2;
+	}
+#endif
+
+	if (loadPath)
+	{
+		FileSavestateReader reader(loadPath);
+		Chip8State state;
+		if (!reader.Read(state) || !chip8.LoadState(state))
+		{
+			fprintf(stderr, "Could not load a savestate from %s\n", loadPath);
+			return 1;
+		}
+	}
+
+	Chip8PerfCounters counters;
+	if (countersWanted && !counters.Open())
+	{
+		fprintf(stderr, "No performance counters on this platform\n");
+		return 2;
+	}
+
+	FILE *hashes = NULL;
+	if (hashesPath && (hashes = fopen(hashesPath, "w")) == NULL)
+	{
+		fprintf(stderr, "Could not write %s\n", hashesPath);
+		return 1;
+	}
+
+	Chip8Scheduler scheduler(chip8);
+	scheduler.SetInstructionsPerSecond(ips);
+	std::unique_ptr<Chip8Memo> memo;
+	if (memoMegabytes > 0)
+	{
+		memo.reset(new Chip8Memo(chip8, scheduler, (size_t)memoMegabytes << 20));
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	if (countersWanted) counters.Start();
+	Clock::time_point start = Clock::now();
+
+	long long frame = 0;
+	long long executed = 0; // Instructions handed to Run()
+	static Chip8State runAheadState;
+	Clock::duration runAheadTime = Clock::duration::zero();
+
+	// State hash at the start of every emulated second, the frames of a second run different numbers of instructions
+	// unless ips is a multiple of 60, so only states at the same position in the second can repeat each other
+	struct Second
+	{
+		long long frame;
+		long long executed;
+	};
+	std::unordered_map<U64, Second> secondStates;
+	long long cycleStart = -1;
+	long long cyclePeriod = 0;
+	long long skippedFrames = 0;
+	long long skippedInstructions = 0;
+	size_t nextEvent = 0;
+	while (instructions < 0 ? frame < frames : executed < instructions)
+	{
+		for (; nextEvent < events.size() && events[nextEvent].frame <= frame; nextEvent++)
+		{
+			chip8.SetKey(events[nextEvent].key, events[nextEvent].pressed);
+		}
+
+		int count = scheduler.NextFrameInstructions();
+		if (instructions >= 0 && count > instructions - executed)
+		{
+			count = (int)(instructions - executed);
+		}
+		if (memo)
+		{
+			memo->RunFrame(count);
+		}
+		else
+		{
+			chip8.Run(count);
+			scheduler.TickTimers();
+		}
+		executed += count;
+		frame++;
+
+		if (hashes)
+		{
+			fprintf(hashes, "%lld %016llx\n", frame, chip8.GetStateHash());
+		}
+
+		// The state at frame + k * period is the state now, so k periods can be left out without changing the result
+		if (stopOnCycle && instructions < 0 && cyclePeriod == 0 && frame % 60 == 0 && nextEvent == events.size())
+		{
+			Second second = { frame, executed };
+			auto seen = secondStates.insert(std::make_pair(chip8.GetStateHash(), second));
+			if (!seen.second)
+			{
+				cycleStart = seen.first->second.frame;
+				cyclePeriod = frame - cycleStart;
+				long long periods = (frames - frame) / cyclePeriod;
+				skippedFrames = periods * cyclePeriod;
+				frame += skippedFrames;
+				skippedInstructions = periods * (executed - seen.first->second.executed);
+				executed += skippedInstructions;
+				secondStates.clear();
+			}
+		}
+
+		if (runAhead > 0)
+		{
+			// What the front end does after every frame, the results must not change
+			Clock::time_point aheadStart = Clock::now();
+			chip8.SaveState(runAheadState);
+			scheduler.RunAhead(runAhead);
+			chip8.LoadState(runAheadState);
+			runAheadTime += Clock::now() - aheadStart;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	if (hashes) fclose(hashes);
+	if (countersWanted) counters.Stop();
+
+	const U8 *reg = chip8.GetRegisters();
+	printf("rom          %s\n", romPath);
+	printf("frames       %lld\n", frame);
+	printf("instructions %lld\n", executed);
+	printf("display      %016llx\n", DisplayHash(chip8));
+	printf("state        %016llx\n", chip8.GetStateHash());
+	printf("registers   ");
+	for (int i = 0; i < 16; i++)
+	{
+		printf(" %02X", reg[i]);
+	}
+	printf("\n");
+	printf("I %03X  PC %03X  SP %X  DT %02X  ST %02X\n", chip8.GetI(), chip8.GetPC(), chip8.GetStackPointer(), chip8.delayTimer, chip8.soundTimer);
+	long long ranInstructions = executed - skippedInstructions; // Skipped cycles take no time
+	long long ranFrames = frame - skippedFrames;
+	printf("time         %.6f s, %.2f MIPS, %.0f frames/s\n", seconds,
+		seconds > 0 ? ranInstructions / seconds / 1e6 : 0.0, seconds > 0 ? ranFrames / seconds : 0.0);
+	if (cyclePeriod > 0)
+	{
+		printf("cycle        %lld frames from frame %lld, %lld frames skipped\n", cyclePeriod, cycleStart, skippedFrames);
+	}
+	if (memo)
+	{
+		printf("memo         %lld hits, %lld misses, %d entries in %zu bytes\n", memo->GetHits(), memo->GetMisses(),
+			memo->GetEntryCount(), memo->GetUsedBytes());
+	}
+	if (runAhead > 0)
+	{
+		printf("run-ahead    %d frames, %.3f us per frame\n", runAhead,
+			frame > 0 ? std::chrono::duration<double, std::micro>(runAheadTime).count() / frame : 0.0);
+	}
+
+	if (countersWanted)
+	{
+		printf("counters     %s, per instruction / per frame\n", counters.GetSource());
+		for (int i = 0; i < Chip8PerfCounters::COUNTER_COUNT; i++)
+		{
+			Chip8PerfCounters::Counter counter = (Chip8PerfCounters::Counter)i;
+			if (!counters.IsAvailable(counter)) continue;
+			long long value = counters.Get(counter);
+			printf("  %-17s %14lld %12.4f %12.2f\n", Chip8PerfCounters::Name(counter), value,
+				ranInstructions > 0 ? (double)value / ranInstructions : 0.0, ranFrames > 0 ? (double)value / ranFrames : 0.0);
+		}
+	}
+
+	if (savePath)
+	{
+		FileSavestateWriter writer(savePath);
+		Chip8State state;
+		chip8.SaveState(state);
+		if (!writer.Write(state))
+		{
+			fprintf(stderr, "Could not write the savestate to %s\n", savePath);
+			return 1;
+		}
+	}
+
+#ifdef CHIP8_PROFILE
+	if (profilePath && !WriteProfile(profiler, profilePath))
+	{
+		fprintf(stderr, "Could not write the profile to %s.*\n", profilePath);
+		return 1;
+	}
+#endif
+
+	if (screen)
+	{
+		const U64 *display = chip8.GetDisplay();
+		for (int row = 0; row < 32; row++)
+		{
+			char line[65];
+			for (int column = 0; column < 64; column++)
+			{
+				line[column] = (display[row] >> (63 - column)) & 1 ? '#' : '.';
+			}
+			line[64] = 0;
+			printf("%s\n", line);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,418 @@
+// Chip8Recompiler: translates a CHIP-8 ROM ahead of time into a C++ file for the CORE_STATIC core of PDevEmulator
+//
+// Usage: Chip8Recompiler [--check] <rom> <output.cpp> [name]
+//
+// Starting at 0x200 it follows every jump, call, return address and skip to find the reachable code,
+// splits it into basic blocks and writes each block as straight C++ operating on local copies of V0-VF and I.
+// Jumps between blocks become gotos, so the host compiler sees (and optimizes) whole routines.
+// Anything that depends on the rest of the machine (drawing, keys, random numbers, memory writes, ...)
+// is handed to the interpreter one instruction at a time, and computed jumps (BNNN) and returns
+// go through a switch on the program counter that leaves the generated code for unknown addresses.
+// An interpreted write into translated instructions disables the program and the generated code returns right after it.
+// Backward jumps and FX0A skip idle loops the same way the interpreter does (Chip8::SkipIdle()).
+// RecompiledPONG.cpp and Recompiled15PUZZLE.cpp in PDevEmulator are generated by it: the project regenerates them after every build
+// of the tool, and the projects that compile them build it first. Chip8Bench compares CORE_STATIC with the interpreter on them.
+
+#define _CRT_SECURE_NO_WARNINGS // fopen and sprintf, the tool is also built outside of Visual Studio
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef unsigned char U8;
+typedef unsigned short U16;
+
+U8 memoryBuffer[4096] = { 0 };
+int romSize = 0;
+
+U16 Opcode(U16 address)
+{
+	return (memoryBuffer[address] << 8) | memoryBuffer[address + 1];
+}
+
+bool InRom(U16 address)
+{
+	return address >= 0x200 && address + 1 < 0x200 + romSize;
+}
+
+// How control leaves an instruction
+enum Flow
+{
+	FLOW_NEXT, // Continues with the next instruction
+	FLOW_JUMP, // 1NNN
+	FLOW_CALL, // 2NNN
+	FLOW_SKIP, // 3XNN, 4XNN, 5XY0, 9XY0, EX9E, EXA1
+	FLOW_RETURN, // 00EE
+	FLOW_COMPUTED // BNNN
+};
+
+Flow GetFlow(U16 opcode)
+{
+	switch (opcode & 0xF000)
+	{
+	case 0x0000: return (opcode & 0x00FF) == 0x00EE ? FLOW_RETURN : FLOW_NEXT;
+	case 0x1000: return FLOW_JUMP;
+	case 0x2000: return FLOW_CALL;
+	case 0x3000:
+	case 0x4000:
+	case 0x5000:
+	case 0x9000: return FLOW_SKIP;
+	case 0xB000: return FLOW_COMPUTED;
+	case 0xE000: return ((opcode & 0x000F) == 0x000E || (opcode & 0x000F) == 0x0001) ? FLOW_SKIP : FLOW_NEXT;
+	}
+	return FLOW_NEXT;
+}
+
+std::set<U16> code; // Addresses of reachable instructions
+std::set<U16> leaders; // Addresses that start a basic block
+std::set<U16> labels; // Blocks a goto jumps to, the others are only reached through the switch
+
+void Analyze()
+{
+	std::vector<U16> work;
+	work.push_back(0x200);
+	leaders.insert(0x200);
+
+	while (!work.empty())
+	{
+		U16 address = work.back();
+		work.pop_back();
+
+		while (InRom(address) && code.count(address) == 0)
+		{
+			code.insert(address);
+			U16 opcode = Opcode(address);
+			U16 nnn = opcode & 0x0FFF;
+			Flow flow = GetFlow(opcode);
+
+			if ((opcode & 0xF0FF) == 0xF00A)
+			{
+				leaders.insert(address); // Repeats itself until a key is pressed, the switch on the program counter has to find it
+			}
+			if (flow == FLOW_JUMP || flow == FLOW_CALL)
+			{
+				leaders.insert(nnn);
+				work.push_back(nnn);
+			}
+			if (flow == FLOW_CALL || flow == FLOW_SKIP)
+			{
+				leaders.insert(address + 2); // Return address, or the instruction that is skipped
+			}
+			if (flow == FLOW_SKIP)
+			{
+				leaders.insert(address + 4);
+				work.push_back(address + 4);
+			}
+			if (flow == FLOW_JUMP || flow == FLOW_RETURN || flow == FLOW_COMPUTED)
+			{
+				break;
+			}
+			address += 2;
+		}
+	}
+}
+
+std::string Hex(int value)
+{
+	char text[16];
+	sprintf(text, "0x%03X", value);
+	return text;
+}
+
+// Appends to the generated code, which is kept in memory: the labels a block needs are only known once all blocks are done
+void Print(std::string &out, const char *format, ...)
+{
+	char text[512];
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(text, sizeof(text), format, arguments);
+	va_end(arguments);
+	out += text;
+}
+
+std::string Goto(U16 address)
+{
+	if (code.count(address) != 0 && leaders.count(address) != 0)
+	{
+		labels.insert(address);
+		char text[32];
+		sprintf(text, "goto B_%03X;", address);
+		return text;
+	}
+	return "{ PC = " + Hex(address) + "; goto exit; }"; // Not translated, leave it to the interpreter
+}
+
+std::string V(int index)
+{
+	char text[8];
+	sprintf(text, "V%X", index);
+	return text;
+}
+
+// Writes the C++ for the instruction at address, returns whether it can continue with the next one
+bool EmitInstruction(std::string &out, U16 address)
+{
+	U16 opcode = Opcode(address);
+	std::string x = V((opcode & 0x0F00) >> 8);
+	std::string y = V((opcode & 0x00F0) >> 4);
+	std::string nn = Hex(opcode & 0x00FF);
+	std::string nnn = Hex(opcode & 0x0FFF);
+	U16 next = address + 2;
+	std::string line;
+	bool interpret = false;
+	bool mayRedirect = false; // The interpreted instruction can skip or repeat itself
+	bool mayWait = false; // The interpreted instruction repeats itself until a key is pressed
+	bool continues = true; // Control can reach the instruction after it
+
+	Print(out, "\t\t// %s: %04X\n", Hex(address).c_str(), opcode);
+	Print(out, "\t\texecuted++;\n");
+
+	switch (opcode & 0xF000)
+	{
+	case 0x0000:
+		if ((opcode & 0x00FF) == 0x00EE)
+		{
+			line = "SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;"; // Wraps like the interpreter
+			continues = false;
+		}
+		else interpret = true;
+		break;
+	case 0x1000:
+		line = Goto(opcode & 0x0FFF);
+		if ((opcode & 0x0FFF) <= address)
+		{
+			// Backward, maybe an idle loop the interpreter would skip the rest of the batch of
+			line = "PC = " + nnn + "; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); " + line;
+		}
+		continues = false;
+		break;
+	case 0x2000: line = "s.stack[SP & 0xF] = " + Hex(next) + "; SP = (SP & 0xF) + 1; " + Goto(opcode & 0x0FFF); continues = false; break;
+	case 0x3000: line = "if (" + x + " == " + nn + ") " + Goto(next + 2) + "\n\t\t" + Goto(next); continues = false; break;
+	case 0x4000: line = "if (" + x + " != " + nn + ") " + Goto(next + 2) + "\n\t\t" + Goto(next); continues = false; break;
+	case 0x5000: line = "if (" + x + " == " + y + ") " + Goto(next + 2) + "\n\t\t" + Goto(next); continues = false; break;
+	case 0x6000: line = x + " = " + nn + ";"; break;
+	case 0x7000: line = x + " += " + nn + ";"; break;
+	case 0x8000:
+		switch (opcode & 0x000F)
+		{
+		case 0x0: line = x + " = " + y + ";"; break;
+		case 0x1: line = x + " |= " + y + ";"; break;
+		case 0x2: line = x + " &= " + y + ";"; break;
+		case 0x3: line = x + " ^= " + y + ";"; break;
+		case 0x4: line = "VF = (" + x + " + " + y + ") > 255 ? 1 : 0; " + x + " += " + y + ";"; break;
+		case 0x5: line = "VF = " + y + " > " + x + " ? 0 : 1; " + x + " -= " + y + ";"; break;
+		case 0x6: line = "VF = " + x + " & 0x1; " + x + " >>= 1;"; break;
+		case 0x7: line = "VF = " + y + " < " + x + " ? 0 : 1; " + x + " = " + y + " - " + x + ";"; break;
+		case 0xE: line = "VF = " + x + " >> 7; " + x + " <<= 1;"; break;
+		default: line = "// Unknown opcode"; break;
+		}
+		break;
+	case 0x9000: line = "if (" + x + " != " + y + ") " + Goto(next + 2) + "\n\t\t" + Goto(next); continues = false; break;
+	case 0xA000: line = "I = " + nnn + ";"; break;
+	case 0xB000: line = "PC = " + nnn + " + V0; goto dispatch;"; continues = false; break;
+	case 0xE000:
+		interpret = true;
+		mayRedirect = true;
+		break;
+	case 0xF000:
+		switch (opcode & 0x00FF)
+		{
+		case 0x07: line = x + " = *s.delayTimer;"; break;
+		case 0x15: line = "*s.delayTimer = " + x + ";"; break;
+		case 0x18: line = "*s.soundTimer = " + x + ";"; break;
+		case 0x1E: line = "VF = (I + " + x + ") > 0xFFF ? 1 : 0; I += " + x + ";"; break;
+		case 0x29: line = "I = " + x + " * 5;"; break;
+		case 0x0A: interpret = true; mayRedirect = true; mayWait = true; break;
+		default: interpret = true; break;
+		}
+		break;
+	default:
+		interpret = true; // 0xC000 (random) and 0xD000 (draw)
+		break;
+	}
+
+	if (interpret)
+	{
+		// A write into the translated code disables it, nothing after the write may run
+		Print(out, "\t\tPC = %s; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();\n", Hex(address).c_str());
+		if (mayWait)
+		{
+			Print(out, "\t\tif (PC == %s) executed = count - Chip8Recompiled::Loop(s, count - executed);\n", Hex(address).c_str());
+		}
+		if (mayRedirect)
+		{
+			Print(out, "\t\tif (PC != %s) goto dispatch;\n", Hex(next).c_str());
+		}
+	}
+	else
+	{
+		Print(out, "\t\t%s\n", line.c_str());
+	}
+	return continues;
+}
+
+int main(int argc, char *argv[])
+{
+	// --check compares the output file with what it would write instead of writing it, for a check that the files in the tree are current
+	bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+	if (check)
+	{
+		argc--;
+		argv++;
+	}
+	if (argc < 3)
+	{
+		printf("Usage: Chip8Recompiler [--check] <rom> <output.cpp> [name]\n");
+		return 1;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	if (file == NULL)
+	{
+		printf("Could not open %s\n", argv[1]);
+		return 1;
+	}
+	romSize = (int)fread(&memoryBuffer[0x200], 1, 4096 - 0x200, file);
+	fclose(file);
+
+	std::string name = argc > 3 ? argv[3] : argv[1];
+	size_t slash = name.find_last_of("/\\");
+	if (slash != std::string::npos) name = name.substr(slash + 1);
+
+	Analyze();
+
+	// FNV-1a, the same hash Chip8Recompiled::Hash() computes at load time
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < romSize; i++)
+	{
+		hash ^= memoryBuffer[0x200 + i];
+		hash *= 16777619u;
+	}
+
+	std::string source;
+
+	// Both bytes of every translated instruction, data next to the code can still be written
+	unsigned int codeBits[128] = { 0 };
+	for (std::set<U16>::iterator address = code.begin(); address != code.end(); ++address)
+	{
+		for (int i = *address; i < *address + 2; i++)
+		{
+			codeBits[i >> 5] |= 1u << (i & 31);
+		}
+	}
+
+	Print(source, "// Generated by Chip8Recompiler from %s, do not edit\n", name.c_str());
+	Print(source, "#include \"Chip8Recompiled.h\"\n\n");
+	Print(source, "#define STORE() ");
+	for (int i = 0; i < 16; i++) Print(source, "s.reg[%d] = %s; ", i, V(i).c_str());
+	Print(source, "*s.regI = I; *s.stackPointer = SP; *s.regPC = PC\n");
+	Print(source, "#define LOAD() ");
+	for (int i = 0; i < 16; i++) Print(source, "%s = s.reg[%d]; ", V(i).c_str(), i);
+	Print(source, "I = *s.regI; SP = *s.stackPointer; PC = *s.regPC\n\n");
+
+	Print(source, "namespace\n{\n");
+	Print(source, "const U32 code[128] =\n{");
+	for (int i = 0; i < 128; i++)
+	{
+		Print(source, "%s0x%08X%s", i % 8 == 0 ? "\n\t" : " ", codeBits[i], i < 127 ? "," : "");
+	}
+	Print(source, "\n};\n\n");
+	Print(source, "int Run(RecompiledState &s, int count)\n{\n");
+	Print(source, "\tU8 ");
+	for (int i = 0; i < 16; i++) Print(source, "%s%s = s.reg[%d]", i ? ", " : "", V(i).c_str(), i);
+	Print(source, ";\n\tU16 I = *s.regI;\n\tU16 SP = *s.stackPointer;\n\tU16 PC = *s.regPC;\n\tint executed = 0;\n\n");
+	Print(source, "dispatch:\n\tswitch (PC)\n\t{\n");
+
+	std::vector<std::pair<U16, std::string> > blocks;
+	for (std::set<U16>::iterator leader = leaders.begin(); leader != leaders.end(); ++leader)
+	{
+		U16 address = *leader;
+		if (code.count(address) == 0) continue;
+
+		// The block runs up to its last instruction or the next leader
+		std::vector<U16> block;
+		for (;;)
+		{
+			block.push_back(address);
+			Flow flow = GetFlow(Opcode(address));
+			U16 next = address + 2;
+			if (flow != FLOW_NEXT || code.count(next) == 0 || leaders.count(next) != 0) break;
+			address = next;
+		}
+
+		std::string text;
+		Print(text, "\t\tif (count - executed < %d) { PC = %s; goto exit; }\n", (int)block.size(), Hex(*leader).c_str());
+		bool continues = true;
+		for (size_t i = 0; i < block.size(); i++)
+		{
+			continues = EmitInstruction(text, block[i]);
+		}
+
+		// Every block ends in a goto, none falls through into the case below it
+		if (continues)
+		{
+			Print(text, "\t\t%s\n", Goto(block.back() + 2).c_str());
+		}
+		blocks.push_back(std::make_pair(*leader, text));
+	}
+
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		Print(source, "\tcase %s:\n", Hex(blocks[i].first).c_str());
+		if (labels.count(blocks[i].first) != 0)
+		{
+			Print(source, "\tB_%03X:\n", blocks[i].first);
+		}
+		source += blocks[i].second + "\n";
+	}
+
+	Print(source, "\tdefault:\n\t\tgoto exit;\n\t}\n\n");
+	Print(source, "exit:\n\tSTORE();\n\treturn executed;\n}\n\n");
+	Print(source, "RecompiledProgram program = { \"%s\", %uu, %d, code, Run, nullptr };\n", name.c_str(), hash, romSize);
+	Print(source, "RecompiledRegistration registration(program);\n");
+	Print(source, "}\n");
+
+	// The file is only written when it changes, so a build that runs the recompiler does not recompile it every time
+	std::string current;
+	file = fopen(argv[2], "rb");
+	if (file != NULL)
+	{
+		char buffer[4096];
+		size_t size;
+		while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			current.append(buffer, size);
+		}
+		fclose(file);
+		current.erase(std::remove(current.begin(), current.end(), '\r'), current.end()); // Written in text mode on Windows
+	}
+
+	if (current == source)
+	{
+		printf("%s: %d instructions in %d blocks, %s is up to date\n", name.c_str(), (int)code.size(), (int)leaders.size(), argv[2]);
+		return 0;
+	}
+	if (check)
+	{
+		printf("%s is not what Chip8Recompiler generates for %s, regenerate it\n", argv[2], argv[1]);
+		return 1;
+	}
+
+	FILE *out = fopen(argv[2], "w");
+	if (out == NULL)
+	{
+		printf("Could not create %s\n", argv[2]);
+		return 1;
+	}
+	fputs(source.c_str(), out);
+	fclose(out);
+
+	printf("%s: %d instructions in %d blocks\n", name.c_str(), (int)code.size(), (int)leaders.size());
+	return 0;
+}
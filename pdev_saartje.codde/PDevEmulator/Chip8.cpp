@@ -1,4 +1,20 @@
 #include "Chip8.h"
+#include "Chip8Fork.h"
+#include "Chip8Jit.h"
+#include "Chip8Recompiled.h"
+#ifdef CHIP8_PROFILE
+#include "Chip8Profiler.h"
+#endif
+
+#include <cstring>
+
+Chip8::Chip8()
+{
+}
+
+Chip8::~Chip8()
+{
+}
 
 bool Chip8::Initialize(const char *path)
 {
@@ -14,10 +30,11 @@ bool Chip8::Initialize(const char *path)
 		keys[i] = 0;
 	}
 
-	for (int i = 0; i < 2048; i++)
+	for (int i = 0; i < 32; i++)
 	{
 		display[i] = 0;
 	}
+	dirtyRows = 0xFFFFFFFF;
 
 	regI = 0;
 	regPC = 0x200;
@@ -25,26 +42,11 @@ bool Chip8::Initialize(const char *path)
 	delayTimer = 0;
 	soundTimer = 0;
 	keyPress = 0;
+	randomState = 1;
 
 	LoadFile(path);
 	if (file == NULL) return 0;
 
-	// - Fixes for two compatibilty problems -
-	int checkSum = 0;
-
-	for (int i = 512; i < (4096 - 512); i++)
-	{
-		checkSum += memoryBuffer[i];
-	}
-	if (checkSum == 19434) // CONNECT4
-	{
-		incrementRegI = false; // The increment should not be there for connect 4 to work
-	}
-	if (checkSum == 40068) // BLITZ
-	{
-		ignorePixel = true; // Disabled pixel wrapping, pixels should be ignored for blitz to work
-	}
-
 	return 1;
 }
 
@@ -96,419 +98,748 @@ void Chip8::LoadFile(const char *path)
 	};
 
 	//std::FILE* binaryFile;
-	errno_t err = fopen_s(&file, path, "r");
+#if defined(_MSC_VER)
+	fopen_s(&file, path, "rb");
+#else
+	file = fopen(path, "rb");
+#endif
+	recompiled = nullptr;
 	if (file != NULL)
 	{
-		std::fread(&memoryBuffer[0x200], sizeof U8, 4096, file);
+		size_t romSize = std::fread(&memoryBuffer[0x200], sizeof(U8), sizeof(memoryBuffer) - 0x200, file);
+		recompiled = Chip8Recompiled::Find(&memoryBuffer[0x200], (int)romSize);
+	}
+
+	// - Fixes for compatibilty problems -
+	if (quirksFromChecksum)
+	{
+		int checkSum = 0;
+
+		for (int i = 512; i < (4096 - 512); i++)
+		{
+			checkSum += memoryBuffer[i];
+		}
+		if (checkSum == 19434) // CONNECT4
+		{
+			SelectQuirkProfile(QUIRKS_CONNECT4); // The increment should not be there for connect 4 to work
+		}
+		else if (checkSum == 40068) // BLITZ
+		{
+			SelectQuirkProfile(QUIRKS_BLITZ); // Disabled pixel wrapping, pixels should be ignored for blitz to work
+		}
+		else
+		{
+			SelectQuirkProfile(QUIRKS_DEFAULT);
+		}
+	}
+
+	idleLoop = NO_IDLE_LOOP;
+	idleLength = 0;
+
+	// New program in memory, throw away all previously decoded instructions
+	for (int i = 0; i < 4096; i++)
+	{
+		decodeCache[i].handler = H_UNDECODED;
+	}
+	if (jit)
+	{
+		jit->Flush();
+	}
+	forkWrittenChunks = 0xFFFF;
+	hashChunks = 0xFFFF;
+	stateChunks = 0xFFFF;
+}
+
+const Chip8::QuirkProfileInfo Chip8::quirkProfiles[QUIRKS_COUNT] =
+{
+	MakeQuirkProfile<QuirksDefault>(),
+	MakeQuirkProfile<QuirksConnect4>(),
+	MakeQuirkProfile<QuirksBlitz>(),
+	MakeQuirkProfile<QuirksVip>()
+};
+
+template <class Q>
+Chip8::QuirkProfileInfo Chip8::MakeQuirkProfile()
+{
+	QuirkProfileInfo info =
+	{
+		Q::incrementRegI, Q::ignorePixel, Q::shiftVY, Q::jumpVX, Q::resetVF, Q::displayWait,
+		&Chip8::TickQuirks<Q>, &Chip8::RunSwitch<Q>, &Chip8::RunThreaded<Q>, &Chip8::Execute<Q>
+	};
+	return info;
+}
+
+void Chip8::SetQuirkProfile(QuirkProfile profile)
+{
+	quirksFromChecksum = false;
+	SelectQuirkProfile(profile);
+}
+
+void Chip8::SelectQuirkProfile(QuirkProfile profile)
+{
+	quirks = &quirkProfiles[profile];
+	idleLength = 0;
+	if (jit)
+	{
+		jit->Flush(); // Compiled for the previous profile
 	}
 }
 
 void Chip8::Tick()
 {
-	opcode = (memoryBuffer[regPC] << 8) | (memoryBuffer[regPC + 1]); // Bitwise shift of 8 bits to the left then OR it with the next byte of memory
-	U16 address = opcode & 0x0FFF;
+	int remaining = 0; // A single instruction, nothing to fast-forward
+	(this->*quirks->tick)(remaining);
+}
+
+template <class Q>
+void Chip8::TickQuirks(int &remaining)
+{
+	// Decode the instruction the first time this address is executed, afterwards reuse the cached result
+	Instruction &instruction = decodeCache[regPC & 0x0FFF];
+	if (instruction.handler == H_UNDECODED)
+	{
+		Decode(regPC, instruction);
+	}
 
 	regPC += 2; // CHIP-8 commands are 2 bytes
 
-	U8 x = (opcode & 0x0F00) >> 8;
-	U8 y = (opcode & 0x00F0) >> 4;
+	Execute<Q>(&instruction, remaining);
+}
+
+void Chip8::Decode(U16 address, Instruction &instruction) const
+{
+	U16 opcode = (memoryBuffer[address & 0x0FFF] << 8) | (memoryBuffer[(address + 1) & 0x0FFF]); // Bitwise shift of 8 bits to the left then OR it with the next byte of memory
+
+	instruction.handler = H_NOP;
+	instruction.x = (opcode & 0x0F00) >> 8;
+	instruction.y = (opcode & 0x00F0) >> 4;
+	instruction.n = opcode & 0x000F;
+	instruction.nn = opcode & 0x00FF;
+	instruction.nnn = opcode & 0x0FFF;
 
 	switch (opcode & 0xF000)
 	{
 	case 0x0000:
 		switch (opcode & 0x00FF)
 		{
+		case 0x00E0: instruction.handler = H_CLS; break;
+		case 0x00EE: instruction.handler = H_RET; break;
 		case 0x00C0:
-			std::cout << "SCHIP-8 /case 0x00CN" << std::endl;
-			// SCHIP-8; Scroll display N lines down
-			break;
-		case 0x00E0:
-			//std::cout << "case 0x00E0" << std::endl;
-			// Clear the screen
-			for (int i = 0; i < 32 * 64; i++)
-			{
-				display[i] = 0;
-			}
-			break;
-		case 0x00EE:
-			//std::cout << "case 0x00EE" << std::endl;
-			// Return from a subroutine
-			--stackPointer; // remove the top stack
-			regPC = stack[stackPointer]; // set regPC to the previous stack				
-			break;
 		case 0x00FB:
-			std::cout << "SCHIP-8 /case 0x00FB" << std::endl;
-			// Scroll display 4 pixels RIGHT
-			break;
 		case 0x00FC:
-			std::cout << "SCHIP-8 /case 0x00FC" << std::endl;
-			// Scroll display 4 pixels LEFT
-			break;
 		case 0x00FD:
-			std::cout << "SCHIP-8 /case 0x00FD" << std::endl;
-			// Exit CHIP interpreter
-			break;
 		case 0x00FE:
-			std::cout << "SCHIP-8 /case 0x00FE" << std::endl;
-			// Disable extended screen mode
-			break;
-		case 0x00FF:
-			std::cout << "SCHIP-8 /case 0x00FF" << std::endl;
-			// Enable extended screen mode for full-screen graphics
-			break;
+		case 0x00FF: instruction.handler = H_SCHIP; break;
 		}
 		break;
-	case 0x1000:
-		//std::cout << "case 0x1000" << std::endl;
-		// Jump to address NNN
-		regPC = (opcode & 0x0FFF);
-		break;
-	case 0x2000:
-		//std::cout << "case 0x2000" << std::endl;
-		// Execute subroutine starting at address NNN
-		stack[stackPointer] = regPC;
-		++stackPointer;
-		regPC = (opcode & 0x0FFF);
-		break;
-	case 0x3000:
-		//std::cout << "case 0x3000" << std::endl;
-		// Skip the following instruction if the value of register VX equals NN
-		if (reg[x] == (opcode & 0x00FF))
+	case 0x1000: instruction.handler = H_JP; break;
+	case 0x2000: instruction.handler = H_CALL; break;
+	case 0x3000: instruction.handler = H_SE_NN; break;
+	case 0x4000: instruction.handler = H_SNE_NN; break;
+	case 0x5000: instruction.handler = H_SE_XY; break;
+	case 0x6000: instruction.handler = H_LD_NN; break;
+	case 0x7000: instruction.handler = H_ADD_NN; break;
+	case 0x8000:
+		switch (opcode & 0x000F)
 		{
-			regPC += 2;
+		case 0x0000: instruction.handler = H_LD_XY; break;
+		case 0x0001: instruction.handler = H_OR; break;
+		case 0x0002: instruction.handler = H_AND; break;
+		case 0x0003: instruction.handler = H_XOR; break;
+		case 0x0004: instruction.handler = H_ADD_XY; break;
+		case 0x0005: instruction.handler = H_SUB; break;
+		case 0x0006: instruction.handler = H_SHR; break;
+		case 0x0007: instruction.handler = H_SUBN; break;
+		case 0x000E: instruction.handler = H_SHL; break;
 		}
 		break;
-	case 0x4000:
-		//std::cout << "case 0x4000" << std::endl;
-		// Skip the following instruction if the value of register VX is not equal to NN
-		if (reg[x] != (opcode & 0x00FF))
+	case 0x9000: instruction.handler = H_SNE_XY; break;
+	case 0xA000: instruction.handler = H_LD_I; break;
+	case 0xB000: instruction.handler = H_JP_V0; break;
+	case 0xC000: instruction.handler = H_RND; break;
+	case 0xD000: instruction.handler = H_DRW; break;
+	case 0xE000:
+		switch (opcode & 0x000F)
 		{
-			regPC += 2;
+		case 0x000E: instruction.handler = H_SKP; break;
+		case 0x0001: instruction.handler = H_SKNP; break;
 		}
 		break;
-	case 0x5000:
-		//std::cout << "case 0x5000" << std::endl;
-		// Skip the following instruction if the value of register VX is equal to the value of register VY
-		if (reg[x] == reg[y])
+	case 0xF000:
+		switch (opcode & 0x00FF)
 		{
-			regPC += 2;
+		case 0x0007: instruction.handler = H_LD_VX_DT; break;
+		case 0x000A: instruction.handler = H_LD_K; break;
+		case 0x0015: instruction.handler = H_LD_DT; break;
+		case 0x0018: instruction.handler = H_LD_ST; break;
+		case 0x001E: instruction.handler = H_ADD_I; break;
+		case 0x0029: instruction.handler = H_LD_F; break;
+		case 0x0033: instruction.handler = H_LD_B; break;
+		case 0x0055: instruction.handler = H_LD_MEM_VX; break;
+		case 0x0065: instruction.handler = H_LD_VX_MEM; break;
+		case 0x0030:
+		case 0x0075:
+		case 0x0085: instruction.handler = H_SCHIP; break;
 		}
 		break;
-	case 0x6000:
-		//std::cout << "case 0x6000" << std::endl;
-		// Store number NN in register VX
-		reg[x] = (opcode & 0x00FF);
-		break;
-	case 0x7000:
-		//std::cout << "case 0x7000" << std::endl;
-		// Add the value NN to register VX
-		reg[x] += (opcode & 0x00FF);
-		break;
-	case 0x8000:
-		switch (opcode & 0x000F)
+	}
+}
+
+void Chip8::InvalidateDecoded(U16 address, int count)
+{
+	// A written byte is part of the instruction that starts at it and of the one that starts one byte earlier
+	for (int i = address - 1; i < address + count; i++)
+	{
+		decodeCache[i & 0x0FFF].handler = H_UNDECODED;
+	}
+	if (jit)
+	{
+		jit->Invalidate(address, count);
+	}
+	for (int i = address; recompiled && i < address + count; i++)
+	{
+		if (recompiled->code[(i & 0x0FFF) >> 5] & (1u << (i & 31)))
 		{
-		case 0x0000:
-			//std::cout << "case 0x0000" << std::endl;
-			// Store the value of register VY in register VX
-			reg[x] = reg[y];
-			break;
-		case 0x0001:
-			//std::cout << "case 0x0001" << std::endl;
-			// Set VX to VX OR VY
-			reg[x] |= reg[y];
-			break;
-		case 0x0002:
-			//std::cout << "case 0x0002" << std::endl;
-			// Set VX to VX AND VY
-			reg[x] &= reg[y];
-			break;
-		case 0x0003:
-			//std::cout << "case 0x0003" << std::endl;
-			// Set VX to VX XOR VY
-			reg[x] ^= reg[y];
-			break;
-		case 0x0004:
-			//std::cout << "case 0x0004" << std::endl;
-			// Add the value of register VY to register VX
-			// Set VF to 1 if a carry occurs
-			// Set VF to 0 if a carry does not occur
-			if ((reg[x] + reg[y]) > 255)
-			{
-				reg[0x000F] = 1;
-			}
-			else
-			{
-				reg[0x000F] = 0;
-			}
-			reg[x] += reg[y];
-			break;
-		case 0x0005:
-			//std::cout << "case 0x0005" << std::endl;
-			// Subtract the value of register VY from register VX
-			// Set VF to 0 if a borrow occurs
-			// Set VF to 1 if a borrow does not occur
-			if (reg[y] > reg[x])
-			{
-				reg[0xF] = 0;
-			}
-			else
-			{
-				reg[0xF] = 1;
-			}
-			reg[x] -= reg[y];
-			break;
-		case 0x0006:
-			//std::cout << "case 0x0006" << std::endl;
-			// Store the value of register VY shifted right one bit in register VX
-			// Set register VF to the least significant bit prior to the shift
-			reg[0xF] = reg[x] & 0x1;
-			reg[x] >>= 1;
-			break;
-		case 0x0007:
-			//std::cout << "case 0x0007" << std::endl;
-			// Set register VX to the value of VY minus VX
-			// Set VF to 0 if a borrow occurs
-			// Set VF to 1 if a borrow does not occur
-			if (reg[y] < reg[x])
-			{
-				reg[0xF] = 0;
-			}
-			else
-			{
-				reg[0xF] = 1;
-			}
-			reg[x] = reg[y] - reg[x];
-			break;
-		case 0x000E:
-			//std::cout << "case 0x000E" << std::endl;
-			// Store the value of register VY shifted left one bit in register VX
-			// Set register VF to the most significant bit prior to the shift
-			reg[0xF] = reg[x] >> 7;
-			reg[x] <<= 1;
-			break;
+			recompiled = nullptr; // The program modifies its own code, the generated code no longer matches it
 		}
-		break;
-	case 0x9000:
-		//std::cout << "case 0x9000" << std::endl;
-		// Skip the following instruction if the value of register VX is not equal to the value of register VY
-		if (reg[x] != reg[y])
+	}
+	U32 chunks = 0;
+	for (int chunk = address >> 8; chunk <= (address + count - 1) >> 8; chunk++)
+	{
+		chunks |= 1u << (chunk & 0xF);
+	}
+	forkWrittenChunks |= chunks;
+	hashChunks |= chunks;
+	stateChunks |= chunks;
+	idleLoop = NO_IDLE_LOOP;
+}
+
+// Called on backward jumps with the number of instructions left in the batch (after the jump)
+// Timers and keys only change between batches, so when the jump finds registers, I, the stack and the delay timer
+// exactly as they were at the previous jump to the same address, with no memory write, draw, random number or key read in between,
+// the program is spinning in a loop (FX07/3XNN/1NNN polling, a jump to itself, ...) that cannot end within this batch.
+// The rest of the batch would only go round the loop, so skip all whole iterations: the batch ends on the same instruction
+// and in the same state it would have ended in, without executing them
+int Chip8::SkipIdle(U16 loop, int remaining)
+{
+	if (remaining <= 0) return remaining;
+
+	if (loop == idleLoop && remaining < idleRemaining &&
+		memcmp(reg, idleReg, sizeof(reg)) == 0 && regI == idleRegI &&
+		stackPointer == idleStackPointer && memcmp(stack, idleStack, sizeof(stack)) == 0 &&
+		delayTimer == idleDelayTimer)
+	{
+		idleLength = idleRemaining - remaining;
+		idleRemaining = remaining % idleLength;
+		return idleRemaining;
+	}
+
+	idleLoop = loop;
+	idleRemaining = remaining;
+	memcpy(idleReg, reg, sizeof(reg));
+	idleRegI = regI;
+	memcpy(idleStack, stack, sizeof(stack));
+	idleStackPointer = stackPointer;
+	idleDelayTimer = delayTimer;
+	return remaining;
+}
+
+void Chip8::SaveState(Chip8State &state) const
+{
+	memcpy(state.memory, memoryBuffer, sizeof(memoryBuffer));
+	SaveStateExceptMemory(state);
+}
+
+U32 Chip8::UpdateState(Chip8State &state, bool all) const
+{
+	U32 chunks = all ? 0xFFFF : stateChunks;
+	for (int chunk = 0; chunk < 16; chunk++)
+	{
+		if (chunks & (1u << chunk)) memcpy(&state.memory[chunk * 256], &memoryBuffer[chunk * 256], 256);
+	}
+	stateChunks = 0;
+	SaveStateExceptMemory(state);
+	return chunks;
+}
+
+void Chip8::SaveStateExceptMemory(Chip8State &state) const
+{
+	memcpy(state.display, display, sizeof(display));
+	memcpy(state.stack, stack, sizeof(stack));
+	state.regI = regI;
+	state.regPC = regPC;
+	state.stackPointer = stackPointer;
+	memcpy(state.reg, reg, sizeof(reg));
+	memcpy(state.keys, keys, sizeof(keys));
+	state.keyPress = keyPress;
+	state.delayTimer = delayTimer;
+	state.soundTimer = soundTimer;
+	state.quirkProfile = (U8)(quirks - quirkProfiles);
+	state.quirksFromChecksum = quirksFromChecksum ? 1 : 0;
+	state.reserved = 0;
+	state.randomState = randomState;
+}
+
+bool Chip8::LoadState(const Chip8State &state)
+{
+	// Addresses index memory without a mask, a file from elsewhere must not point past it
+	if (state.quirkProfile >= QUIRKS_COUNT || state.stackPointer > 16 || state.regI > 0x0FFF || state.regPC > 0x0FFF)
+	{
+		return false;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		if (state.stack[i] > 0x0FFF) return false;
+	}
+
+	// Only the blocks of memory that differ are copied, so only their decoded instructions and compiled code are thrown away
+	const int block = 64;
+	for (int address = 0; address < 4096; address += block)
+	{
+		if (memcmp(&memoryBuffer[address], &state.memory[address], block) != 0)
 		{
-			regPC += 2;
+			WriteMemory((U16)address, &state.memory[address], block);
 		}
-		break;
-	case 0xA000:
-		//std::cout << "case 0xA000" << std::endl;
-		// Store memory address NNN in register I
-		regI = address;
-		break;
-	case 0xB000:
-		//std::cout << "case 0xB000" << std::endl;
-		// Jump to address NNN + V0
-		regPC = address + reg[0];
-		break;
-	case 0xC000:
-		//std::cout << "case 0xC000" << std::endl;
-		// Set VX to a random number with a mask of NN
-		reg[x] = (rand() % 255) & (opcode & 0x00FF);
-		break;
-	case 0xD000:
+	}
+
+	for (int row = 0; row < 32; row++)
+	{
+		SetDisplayRow(row, state.display[row]);
+	}
+
+	Chip8Registers registers = {};
+	memcpy(registers.stack, state.stack, sizeof(registers.stack));
+	registers.regI = state.regI;
+	registers.regPC = state.regPC;
+	registers.stackPointer = state.stackPointer;
+	memcpy(registers.reg, state.reg, sizeof(registers.reg));
+	memcpy(registers.keys, state.keys, sizeof(registers.keys));
+	registers.keyPress = state.keyPress;
+	registers.delayTimer = state.delayTimer;
+	registers.soundTimer = state.soundTimer;
+	registers.randomState = state.randomState;
+	LoadRegisters(registers);
+
+	if (quirks != &quirkProfiles[state.quirkProfile])
+	{
+		SelectQuirkProfile((QuirkProfile)state.quirkProfile);
+	}
+	quirksFromChecksum = state.quirksFromChecksum != 0;
+	return true;
+}
+
+void Chip8::SaveRegisters(Chip8Registers &registers) const
+{
+	memcpy(registers.stack, stack, sizeof(stack));
+	registers.regI = regI;
+	registers.regPC = regPC;
+	registers.stackPointer = stackPointer;
+	memcpy(registers.reg, reg, sizeof(reg));
+	memcpy(registers.keys, keys, sizeof(keys));
+	registers.keyPress = keyPress;
+	registers.delayTimer = delayTimer;
+	registers.soundTimer = soundTimer;
+	memset(registers.reserved, 0, sizeof(registers.reserved));
+	registers.randomState = randomState;
+}
+
+void Chip8::LoadRegisters(const Chip8Registers &registers)
+{
+	memcpy(stack, registers.stack, sizeof(stack));
+	regI = registers.regI;
+	regPC = registers.regPC;
+	stackPointer = registers.stackPointer;
+	memcpy(reg, registers.reg, sizeof(reg));
+	memcpy(keys, registers.keys, sizeof(keys));
+	keyPress = registers.keyPress;
+	delayTimer = registers.delayTimer;
+	soundTimer = registers.soundTimer;
+	randomState = registers.randomState;
+
+	// Whatever the machine was waiting for or spinning in belongs to the state it was in before
+	waitForFrame = false;
+	idleLoop = NO_IDLE_LOOP;
+	idleLength = 0;
+}
+
+void Chip8::WriteMemory(U16 address, const U8 *bytes, int count)
+{
+	memcpy(&memoryBuffer[address], bytes, count);
+	InvalidateDecoded(address, count);
+	idleLength = 0; // The loop the last Run() ended in may read what changed
+}
+
+void Chip8::SetDisplayRow(int row, U64 value)
+{
+	if (display[row] != value)
 	{
-		//std::cout << "0xD000" << std::endl;
-		// Draw
-		U16 X = reg[x];
-		U16 Y = reg[y];
-		U16 height = opcode & 0x000F;
-		U16 pixel;
+		display[row] = value;
+		dirtyRows |= 1u << row;
+	}
+}
 
-		reg[0xF] = 0; // reset register
-		for (int yPos = 0; yPos < height; ++yPos) // loop over each row
+void Chip8::SaveFork(Chip8Fork &fork)
+{
+	for (int chunk = 0; chunk < Chip8Fork::MEMORY_CHUNKS; chunk++)
+	{
+		// Written chunks are shared too when the program wrote what was already there
+		const U8 *bytes = &memoryBuffer[chunk * Chip8Fork::CHUNK_SIZE];
+		if (!forkChunks[chunk] ||
+			((forkWrittenChunks & (1u << chunk)) != 0 && memcmp(forkChunks[chunk]->bytes, bytes, Chip8Fork::CHUNK_SIZE) != 0))
 		{
-			pixel = memoryBuffer[regI + yPos]; // fetch pixel value from memory starting at position regI
-			for (int xPos = 0; xPos < 8; ++xPos) // loop over 8 bits of one row
-			{
-				if ((pixel & (0x80 >> xPos)) != 0) // check if current pixel is set to 1
-				{
-					int pixelPosition = (X + xPos) + ((Y + yPos) * 64);
-					// For fixing problem n2: 0xDXYN can either ignore pixels that fall outside the screen, or wrap around
-					if (pixelPosition < 0 && !ignorePixel)
-					{
-						pixelPosition = 2047; // -> Wraps to the last pixel
-					}
-					int index = 1;
-					if (pixelPosition > 2047 && ignorePixel)
-					{
-						continue;
-					}
-					while (pixelPosition > 2047)
-					{
-						pixelPosition = (X + xPos) + (((Y - index++) + yPos) * 64);
-					}
-					
-					if (display[pixelPosition] == 1) // check if pixel on display is set to 0,
-					{
-						reg[0xF] = 1; // if it is, register collision by setting register
-					}
-					display[pixelPosition] ^= 1; // set pixel value, using xor
-				}
-			}
+			Chip8ForkChunk *copy = new Chip8ForkChunk;
+			memcpy(copy->bytes, bytes, Chip8Fork::CHUNK_SIZE);
+			forkChunks[chunk].reset(copy);
 		}
+		fork.chunks[chunk] = forkChunks[chunk];
 	}
-	break;
-	case 0xE000:
-		switch (opcode & 0x000F)
+	forkWrittenChunks = 0;
+
+	// Draws are not tracked by chunk, the display is only one
+	std::shared_ptr<const Chip8ForkChunk> &displayChunk = forkChunks[Chip8Fork::DISPLAY_CHUNK];
+	if (!displayChunk || memcmp(displayChunk->bytes, display, sizeof(display)) != 0)
+	{
+		Chip8ForkChunk *copy = new Chip8ForkChunk;
+		memcpy(copy->bytes, display, sizeof(display));
+		displayChunk.reset(copy);
+	}
+	fork.chunks[Chip8Fork::DISPLAY_CHUNK] = displayChunk;
+
+	SaveRegisters(fork.registers);
+	fork.quirkProfile = (U8)(quirks - quirkProfiles);
+	fork.quirksFromChecksum = quirksFromChecksum;
+}
+
+bool Chip8::LoadFork(const Chip8Fork &fork)
+{
+	if (fork.IsEmpty())
+	{
+		return false;
+	}
+
+	for (int chunk = 0; chunk < Chip8Fork::MEMORY_CHUNKS; chunk++)
+	{
+		// Same chunk as loaded or saved last and not written since: memory already holds it
+		if (forkChunks[chunk] == fork.chunks[chunk] && (forkWrittenChunks & (1u << chunk)) == 0) continue;
+
+		U16 address = (U16)(chunk * Chip8Fork::CHUNK_SIZE);
+		if (memcmp(&memoryBuffer[address], fork.chunks[chunk]->bytes, Chip8Fork::CHUNK_SIZE) != 0)
 		{
-		case 0x000E:
-			//std::cout << "case 0x000E" << std::endl;
-			// Skip the following instruction if the key currently stored in register VX is pressed
-			if (keys[reg[x]] != 0)
-			{
-				regPC += 2;
-			}
-			break;
-		case 0x0001:
-			//std::cout << "case 0x0001" << std::endl;
-			// Skip the following instruction if the key currently stored in register VX is not pressed
-			if (keys[reg[x]] == 0)
-			{
-				regPC += 2;
-			}
-			break;
+			WriteMemory(address, fork.chunks[chunk]->bytes, Chip8Fork::CHUNK_SIZE);
 		}
-		break;
-	case 0xF000:
-		switch (opcode & 0x00FF)
+		forkChunks[chunk] = fork.chunks[chunk];
+	}
+	forkWrittenChunks = 0;
+
+	// Draws are not tracked, so the display is always compared
+	U64 rows[32]; // The chunk is bytes, memcpy rather than reading it through a U64 pointer
+	memcpy(rows, fork.chunks[Chip8Fork::DISPLAY_CHUNK]->bytes, sizeof(rows));
+	for (int row = 0; row < 32; row++)
+	{
+		SetDisplayRow(row, rows[row]);
+	}
+	forkChunks[Chip8Fork::DISPLAY_CHUNK] = fork.chunks[Chip8Fork::DISPLAY_CHUNK];
+
+	LoadRegisters(fork.registers);
+
+	if (quirks != &quirkProfiles[fork.quirkProfile])
+	{
+		SelectQuirkProfile((QuirkProfile)fork.quirkProfile);
+	}
+	quirksFromChecksum = fork.quirksFromChecksum;
+	return true;
+}
+
+namespace
+{
+	// Finalizer of MurmurHash3, every bit of x affects every bit of the result
+	U64 Mix(U64 x)
+	{
+		x ^= x >> 33;
+		x *= 0xFF51AFD7ED558CCDull;
+		x ^= x >> 33;
+		x *= 0xC4CEB9FE1A85EC53ull;
+		x ^= x >> 33;
+		return x;
+	}
+
+	// Cheaper step for runs of words, the result goes through Mix() at the end
+	U64 Combine(U64 hash, U64 word)
+	{
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 32);
+	}
+}
+
+U64 Chip8::GetStateHash() const
+{
+	// Memory and display are the XOR of their chunk and row hashes, so one of them is replaced by XORing out the old hash
+	for (int chunk = 0; hashChunks != 0 && chunk < 16; chunk++)
+	{
+		if ((hashChunks & (1u << chunk)) == 0) continue;
+
+		U64 hash = chunk + 1;
+		for (int address = chunk * 256; address < (chunk + 1) * 256; address += 8)
 		{
-		case 0x0007:
-			//std::cout << "case 0x0007" << std::endl;					
-			// Store the current value of the delay timer in register VX
-			reg[x] = delayTimer;
-			break;
-		case 0x000A:
-			//std::cout << "case 0x000A" << std::endl;					
-			// Wait for a keypress and store the result in register VX
-			keyPress = 0;
-			for (int i = 0; i < 16; i++)
-			{
-				if (keys[i] != 0)
-				{
-					reg[x] = i;
-					keys[i] = 0;
-					keyPress = 1;
-				}
-			}
-			if (!keyPress)
-			{
-				regPC -= 2; // When there's no keypress received, return  
-			}
-			break;
-		case 0x0015:
-			//std::cout << "case 0x0015" << std::endl;					
-			// Set the delay timer to the value of register VX
-			delayTimer = reg[x];
-			break;
-		case 0x0018:
-			//std::cout << "case 0x0018" << std::endl;					
-			// Set the sound timer to the value of register VX
-			soundTimer = reg[x];
-			break;
-		case 0x001E:
-			//std::cout << "case 0x001E" << std::endl;					
-			// Add the value stored in register VX to register I
-			if (regI + reg[x] > 0xFFF) // for the carry
-			{
-				reg[0xF] = 1; // ex. 5 + 5, 2 digits, reg[0xF] = 1
-			}
-			else
-			{
-				reg[0xF] = 0;
-			}
-			regI += reg[x];
-			break;
-		case 0x0029:
-			//std::cout << "case 0x0029" << std::endl;	
-			// Set I to the memory address of the sprite data corresponding to the hexadecimal digit stored in register VX
-			regI = reg[x] * 5;
-			break;
-		case 0x0033:
-			//std::cout << "case 0x0033" << std::endl;					
-			// Store the binary-coded decimal equivalent of the value stored in register VX at addresses I, I + 1, and I + 2
-			memoryBuffer[regI] = reg[x] / 100;
-			memoryBuffer[regI + 1] = (reg[x] / 10) % 10;
-			memoryBuffer[regI + 2] = (reg[x] % 100) % 10;
-			break;
-		case 0x0030:
-			std::cout << "SCHIP-8 /case 0x0030" << std::endl;
-			// Point to I to 10-byte font sprite for digit VX (0..9)
-			break;
-		case 0x0055:
-			//std::cout << "case 0x0055" << std::endl;					
-			// Store the values of registers V0 to VX inclusive in memory starting at address I
-			// I is set to I + X + 1 after operation
-			for (int i = 0; i <= x; i++)
-			{
-				memoryBuffer[regI + i] = reg[i];
-			}
-			// For fixing problem n1: 0xFX55 and 0xFX65 can either not modify register I, or increment it by X + 1
-			if (incrementRegI)
-			{
-				regI += x + 1;
-			}
-			break;
-		case 0x0065:
-			//std::cout << "case 0x0065" << std::endl;
-			// Fill registers V0 to VX inclusive with the values stored in memory starting at address I
-			// I is set to I + X + 1 after operation
-			for (int i = 0; i <= x; i++)
-			{
-				reg[i] = memoryBuffer[regI + i];
-			}
-			// For fixing problem n1: 0xFX55 and 0xFX65 can either not modify register I, or increment it by X + 1
-			if (incrementRegI)
-			{
-				regI += x + 1;
-			}
-			break;
-		case 0x075:
-			std::cout << "SCHIP-8 /case 0x075" << std::endl;
-			// STORE V0..VX in RPL user flags (x <= 7)
-			break;
-		case 0x085:
-			std::cout << "SCHIP-8 /case 0x085" << std::endl;
-			// READ V0..VX in RPL user flags (x <= 7)
-			break;
+			U64 word;
+			memcpy(&word, &memoryBuffer[address], 8);
+			hash = Combine(hash, word);
 		}
-		break;
+		hash = Mix(hash);
+		memoryHash ^= memoryChunkHashes[chunk] ^ hash;
+		memoryChunkHashes[chunk] = hash;
 	}
+	hashChunks = 0;
+
+	// Draws are not tracked, comparing the rows costs less
+	if (!displayHashed || memcmp(display, hashedRows, sizeof(display)) != 0)
+	{
+		for (int row = 0; row < 32; row++)
+		{
+			if (displayHashed && display[row] == hashedRows[row]) continue;
+
+			U64 hash = Mix(display[row] + (row + 1) * 0x9E3779B97F4A7C15ull);
+			displayHash ^= rowHashes[row] ^ hash;
+			rowHashes[row] = hash;
+			hashedRows[row] = display[row];
+		}
+		displayHashed = true;
+	}
+
+	U64 words[10];
+	memcpy(&words[0], reg, sizeof(reg));
+	memcpy(&words[2], keys, sizeof(keys));
+	memcpy(&words[4], stack, sizeof(stack));
+	words[8] = regI | (U64)regPC << 16 | (U64)stackPointer << 32 | (U64)delayTimer << 48 | (U64)soundTimer << 56;
+	words[9] = randomState | (U64)keyPress << 32 | (U64)(quirks - quirkProfiles) << 40 | (U64)quirksFromChecksum << 48;
+
+	U64 hash = Combine(memoryHash, Mix(displayHash));
+	for (int i = 0; i < 10; i++)
+	{
+		hash = Combine(hash, words[i]);
+	}
+	return Mix(hash);
 }
 
-void Chip8::Draw()
+bool Chip8::IsIdle() const
 {
-	textureVector.clear();
+	return idleLength > 0 && delayTimer == idleDelayTimer;
+}
 
-	for (int y = 0; y < 32; ++y)
+bool Chip8::IsWaitingForFrame() const
+{
+	return waitForFrame;
+}
+
+template <class Q>
+void Chip8::Execute(const Instruction *instruction, int &remaining)
+{
+	U8 x = instruction->x;
+	U8 y = instruction->y;
+
+	switch (instruction->handler)
+	{
+#define OPERATION(handler) case handler: {
+#define END_OPERATION } break;
+#include "Chip8Operations.inl"
+#undef OPERATION
+#undef END_OPERATION
+	}
+}
+
+void Chip8::SetCore(Core c)
+{
+	core = c;
+}
+
+void Chip8::Run(int count)
+{
+	waitForFrame = false;
+	idleLoop = NO_IDLE_LOOP; // remaining counts down from a new count
+
+	// Still in the idle loop the previous batch ended in, only the position in the loop can change
+	if (IsIdle())
+	{
+		count %= idleLength;
+	}
+	idleLength = 0;
+
+#ifdef CHIP8_PROFILE
+	if (profiler)
+	{
+		RunProfiled(count);
+		return;
+	}
+#endif
+
+	if (core == CORE_THREADED)
+	{
+		(this->*quirks->runThreaded)(count);
+		return;
+	}
+	if (core == CORE_JIT)
+	{
+		RunJit(count);
+		return;
+	}
+	if (core == CORE_STATIC)
+	{
+		RunStatic(count);
+		return;
+	}
+
+	(this->*quirks->runSwitch)(count);
+}
+
+template <class Q>
+void Chip8::RunSwitch(int count)
+{
+	int remaining = count;
+	while (remaining > 0)
 	{
-		for (int x = 0; x < 64; ++x)
+		--remaining;
+		TickQuirks<Q>(remaining);
+		if (Q::displayWait && waitForFrame) return;
+	}
+}
+
+#ifdef CHIP8_PROFILE
+void Chip8::RunProfiled(int count)
+{
+	// The switch core, timing every instruction
+	int remaining = count;
+	while (remaining > 0)
+	{
+		--remaining;
+		U16 address = regPC;
+		U16 opcode = (memoryBuffer[address & 0x0FFF] << 8) | memoryBuffer[(address + 1) & 0x0FFF];
+		Chip8Profiler::Clock::time_point start = Chip8Profiler::Clock::now();
+		(this->*quirks->tick)(remaining);
+		profiler->Record(address, opcode, std::chrono::duration_cast<std::chrono::nanoseconds>(Chip8Profiler::Clock::now() - start).count());
+		if (waitForFrame) return;
+	}
+}
+#endif
+
+void Chip8::RunJit(int count)
+{
+	if (!jit)
+	{
+		jit.reset(new Chip8Jit(*this));
+	}
+
+	while (count > 0 && !waitForFrame)
+	{
+		int executed = jit->Execute(count);
+		if (executed == 0) // No code here (or none at all), interpret the rest
 		{
-			if (display[x + y * 64] == 1)
-			{
-				textureVector.push_back(255);
-				textureVector.push_back(255);
-				textureVector.push_back(255);
-			}
-			else
-			{
-				textureVector.push_back(0);
-				textureVector.push_back(0);
-				textureVector.push_back(0);
-			}
+			(this->*quirks->runThreaded)(count);
+			return;
 		}
+		count -= executed;
 	}
 }
 
+void Chip8::RunStatic(int count)
+{
+	// The generated code assumes the original shift, jump and VF behaviour and does not stop after a draw
+	bool compatible = !quirks->shiftVY && !quirks->jumpVX && !quirks->resetVF && !quirks->displayWait;
+
+	while (count > 0 && !waitForFrame)
+	{
+		int executed = 0;
+		if (recompiled && compatible)
+		{
+			RecompiledState state = Chip8Recompiled::Bind(*this);
+			executed = recompiled->run(state, count);
+		}
+		if (executed == 0) // Not recompiled (computed jump, self-modifying code, other ROM), interpret one instruction
+		{
+			Tick();
+			executed = 1;
+		}
+		count -= executed;
+	}
+}
+
+template <class Q>
+void Chip8::RunThreaded(int count)
+{
+#if defined(__GNUC__)
+	// Direct threading: every operation ends by fetching the next instruction and jumping straight to its handler,
+	// so each handler gets its own indirect branch instead of all of them sharing the one of the switch
+	static void *const labels[H_COUNT] =
+	{
+		&&L_H_UNDECODED, &&L_H_NOP, &&L_H_SCHIP, &&L_H_CLS, &&L_H_RET, &&L_H_JP, &&L_H_CALL,
+		&&L_H_SE_NN, &&L_H_SNE_NN, &&L_H_SE_XY, &&L_H_LD_NN, &&L_H_ADD_NN,
+		&&L_H_LD_XY, &&L_H_OR, &&L_H_AND, &&L_H_XOR, &&L_H_ADD_XY, &&L_H_SUB, &&L_H_SHR, &&L_H_SUBN, &&L_H_SHL,
+		&&L_H_SNE_XY, &&L_H_LD_I, &&L_H_JP_V0, &&L_H_RND, &&L_H_DRW, &&L_H_SKP, &&L_H_SKNP,
+		&&L_H_LD_VX_DT, &&L_H_LD_K, &&L_H_LD_DT, &&L_H_LD_ST, &&L_H_ADD_I, &&L_H_LD_F, &&L_H_LD_B,
+		&&L_H_LD_MEM_VX, &&L_H_LD_VX_MEM
+	};
+
+	Instruction *instruction;
+	U8 x;
+	U8 y;
+	int remaining = count;
+
+#define DISPATCH() \
+	if (remaining-- == 0) return; \
+	if (Q::displayWait && waitForFrame) return; \
+	instruction = &decodeCache[regPC & 0x0FFF]; \
+	regPC += 2; \
+	x = instruction->x; \
+	y = instruction->y; \
+	goto *labels[instruction->handler];
+#define OPERATION(handler) L_##handler: {
+#define END_OPERATION } DISPATCH();
+
+	DISPATCH();
+
+L_H_UNDECODED:
+	Decode(regPC - 2, *instruction);
+	x = instruction->x;
+	y = instruction->y;
+	goto *labels[instruction->handler];
+
+L_H_NOP:
+	DISPATCH();
+
+#include "Chip8Operations.inl"
+#undef OPERATION
+#undef END_OPERATION
+#undef DISPATCH
+#else
+	// No computed goto on this compiler, fall back to the switch
+	RunSwitch<Q>(count);
+#endif
+}
+
+U32 Chip8::Draw()
+{
+	U32 rows = dirtyRows;
+	dirtyRows = 0;
+
+	for (int y = 0; y < 32; ++y)
+	{
+		if ((rows & (1u << y)) == 0) continue; // Unchanged, textureBuffer still holds this row
+
+		textureBuffer[y] = display[y];
+	}
+	return rows;
+}
+
+void Chip8::SetKey(U8 key, bool pressed)
+{
+	keys[key & 0xF] = pressed ? 1 : 0;
+	idleLength = 0;
+}
+
 void Chip8::Keypress(U8 k, int action)
 {
 	// Action press = 1; release = 0, repeat = 2
-	if (action == GLFW_REPEAT) return;
+	if (action == 2) return; // GLFW_REPEAT
+	idleLength = 0;
 	if (k == '1') keys[0x1] = action;
 	else if (k == '2') keys[0x2] = action;
 	else if (k == '3') keys[0x3] = action;
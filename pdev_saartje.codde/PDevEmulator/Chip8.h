@@ -1,31 +1,257 @@
 #pragma once
 
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <Windows.h>
-#include <vector>
-
-#include <glad\glad.h>
-#define GLFW_INCLUDE_GLU
-#include <GLFW/glfw3.h>
+#include <memory>
 
 typedef unsigned char U8;
 typedef unsigned short U16;
+typedef unsigned int U32;
+typedef unsigned long long U64;
+
+class Chip8Fork;
+class Chip8Jit;
+class Chip8Profiler;
+class Chip8Recompiled;
+struct Chip8ForkChunk;
+struct RecompiledProgram;
+
+// Compile-time quirk profile, the cores are instantiated once per profile so their hot paths carry no quirk branches
+// - Fixes for compatibilty problems -
+// For fixing problem n1: 0xFX55 and 0xFX65 can either not modify register I, or increment it by X + 1)
+// The increment is required for animal race to work, but should not be there for connect 4 to work.
+// For fixing problem n2: 0xDXYN can either ignore pixels that fall outside the screen, or wrap around)
+// Pixels should be ignored for blitz to work, and wrapped around for vers to work.
+// The others are the well-known differences between the original COSMAC VIP interpreter and later ones
+template <bool IncrementRegI, bool IgnorePixel, bool ShiftVY, bool JumpVX, bool ResetVF, bool DisplayWait>
+struct Quirks
+{
+	static const bool incrementRegI = IncrementRegI; // FX55/FX65 increment I by X + 1
+	static const bool ignorePixel = IgnorePixel; // DXYN ignores pixels outside the screen instead of wrapping them
+	static const bool shiftVY = ShiftVY; // 8XY6/8XYE shift VY into VX instead of shifting VX itself
+	static const bool jumpVX = JumpVX; // BNNN is BXNN, jump to XNN + VX instead of NNN + V0
+	static const bool resetVF = ResetVF; // 8XY1/8XY2/8XY3 set VF to 0
+	static const bool displayWait = DisplayWait; // DXYN waits for the next frame, it ends the batch of instructions
+};
+
+typedef Quirks<true, false, false, false, false, false> QuirksDefault;
+typedef Quirks<false, false, false, false, false, false> QuirksConnect4;
+typedef Quirks<true, true, false, false, false, false> QuirksBlitz;
+typedef Quirks<true, false, true, false, true, true> QuirksVip;
+
+// Registers, stack, timers and keys: a Chip8State without memory, display and quirks
+// No padding, so that two of them compare with memcmp
+struct Chip8Registers
+{
+	U16 stack[16];
+	U16 regI;
+	U16 regPC;
+	U16 stackPointer;
+	U8 reg[16];
+	U8 keys[16];
+	U8 keyPress;
+	U8 delayTimer;
+	U8 soundTimer;
+	U8 reserved[3]; // 0
+	U32 randomState;
+};
+static_assert(sizeof(Chip8Registers) == 80, "Chip8Registers has no padding");
+
+// Complete state of a machine, what Chip8::SaveState() captures and Chip8::LoadState() restores
+// The layout is the one of the savestate format (Chip8Savestate.h): fixed offsets, no padding
+struct Chip8State
+{
+	U8 memory[4096];
+	U64 display[32];
+	U16 stack[16];
+	U16 regI;
+	U16 regPC;
+	U16 stackPointer;
+	U8 reg[16];
+	U8 keys[16];
+	U8 keyPress;
+	U8 delayTimer;
+	U8 soundTimer;
+	U8 quirkProfile; // Chip8::QuirkProfile
+	U8 quirksFromChecksum;
+	U8 reserved; // 0
+	U32 randomState;
+};
+static_assert(sizeof(Chip8State) == 4432, "Chip8State is the savestate format, a new layout needs a new version");
 
 class Chip8
 {
 public:	
+	Chip8();
+	~Chip8();
+	Chip8(const Chip8 &) = delete;
+	Chip8 &operator=(const Chip8 &) = delete;
+
 	bool Initialize(const char *path = "../c8games/SAARTJE");
 	void LoadFile(const char *path = "../c8games/SAARTJE");
 	void Tick();
-	void Draw();
+	void Run(int count); // Execute count instructions with the selected core
+	U32 Draw(); // Copy the display rows that changed since the last call to textureBuffer, returns a mask of those rows
 	void Keypress(U8 k, int action);
+	void SetKey(U8 key, bool pressed); // CHIP-8 key 0x0-0xF, for callers without a keyboard
+
+	// Execution cores, they all give exactly the same results as calling Tick() count times
+	enum Core
+	{
+		CORE_SWITCH, // Tick() in a loop
+		CORE_THREADED, // Direct-threaded dispatch (computed goto on GCC/Clang, the switch elsewhere)
+		CORE_JIT, // Basic blocks compiled to x86-64, the interpreter on other architectures
+		CORE_STATIC // C++ generated ahead of time by Chip8Recompiler for the loaded ROM, Tick() when there is none
+	};
+	void SetCore(Core c);
+
+	// Quirk profiles, one per Quirks typedef above
+	// LoadFile() picks one from the ROM checksum unless SetQuirkProfile() chose one before
+	enum QuirkProfile
+	{
+		QUIRKS_DEFAULT,
+		QUIRKS_CONNECT4,
+		QUIRKS_BLITZ,
+		QUIRKS_VIP,
+		QUIRKS_COUNT
+	};
+	void SetQuirkProfile(QuirkProfile profile);
+
+	// Snapshots of the complete machine state; decoded instructions and compiled code are rebuilt from memory
+	void SaveState(Chip8State &state) const;
+	// The same into a state that holds the last one saved this way, only the memory chunks written since are copied
+	// Returns those chunks, bit n for addresses n * 256 and up; a full copy (all) returns 0xFFFF. For one user, Chip8Rewind.h
+	U32 UpdateState(Chip8State &state, bool all) const;
+	bool LoadState(const Chip8State &state); // False when the state is not valid, the machine is then unchanged
+
+	// Copy-on-write snapshots for search (Chip8Fork.h); both only copy the chunks of memory and display that differ
+	// from the fork saved or loaded last, decoded instructions and compiled code of the other chunks are kept
+	void SaveFork(Chip8Fork &fork);
+	bool LoadFork(const Chip8Fork &fork); // False for an empty fork, the machine is then unchanged
+	static const int FORK_CHUNK_COUNT = 17; // 16 chunks of memory and the display
+
+	// Pieces of a state, for tools that keep memory and display their own way (Chip8Memo.h)
+	void SaveRegisters(Chip8Registers &registers) const;
+	void LoadRegisters(const Chip8Registers &registers); // Also leaves any wait for a frame or idle loop, like LoadState()
+	void WriteMemory(U16 address, const U8 *bytes, int count); // Decoded instructions and compiled code of those bytes are thrown away
+	void SetDisplayRow(int row, U64 value);
+
+	// Hash of everything a Chip8State holds, equal states give equal hashes on every core
+	// Memory and display hashes are kept per 256-byte chunk and per row and only redone for the ones changed since the last call,
+	// the registers, stack and timers change nearly every instruction and are hashed on every call
+	U64 GetStateHash() const;
+
+	bool IsIdle() const; // The last Run() ended in a loop that only a delay timer tick or a keypress can leave
+	bool IsWaitingForFrame() const; // The last Run() ended early on a draw, the profile has displayWait
+	int GetIdleLoopLength() const { return idleLength; } // Instructions per iteration of the loop the last Run() ended in, 0 for none
+
+	// Read-only view of the machine, for tools
+	const U8 *GetRegisters() const { return reg; } // V0-VF
+	U16 GetI() const { return regI; }
+	U16 GetPC() const { return regPC; }
+	U16 GetStackPointer() const { return stackPointer; }
+	const U64 *GetDisplay() const { return display; } // 32 rows, column 0 in the most significant bit
+	const U8 *GetMemory() const { return memoryBuffer; } // 4096 bytes
+	bool HasRecompiledProgram() const { return recompiled != nullptr; } // CORE_STATIC has generated code for the loaded ROM
+
+#ifdef CHIP8_PROFILE
+	// Report every instruction Run() executes to profiler, nullptr to stop; define CHIP8_PROFILE for the whole project
+	void SetProfiler(Chip8Profiler *p) { profiler = p; }
+#endif
 
 	FILE *file;
-	std::vector<U8> textureVector;
+	U64 textureBuffer[32] = { 0 }; // Display as shown, one bit per pixel like display, expanded by the fragment shader
 	U8 delayTimer = 0;
 	U8 soundTimer = 0;
 
 private:
+	friend class Chip8Jit;
+	friend class Chip8Recompiled;
+
+	// Handler ids of the decoded instructions, one per CHIP-8 operation
+	enum Handler : U8
+	{
+		H_UNDECODED = 0, // Cache entry is empty or was invalidated
+		H_NOP, // Unknown opcode, only advances the program counter
+		H_SCHIP, // SCHIP-8 opcode, not supported
+		H_CLS, // 00E0
+		H_RET, // 00EE
+		H_JP, // 1NNN
+		H_CALL, // 2NNN
+		H_SE_NN, // 3XNN
+		H_SNE_NN, // 4XNN
+		H_SE_XY, // 5XY0
+		H_LD_NN, // 6XNN
+		H_ADD_NN, // 7XNN
+		H_LD_XY, // 8XY0
+		H_OR, // 8XY1
+		H_AND, // 8XY2
+		H_XOR, // 8XY3
+		H_ADD_XY, // 8XY4
+		H_SUB, // 8XY5
+		H_SHR, // 8XY6
+		H_SUBN, // 8XY7
+		H_SHL, // 8XYE
+		H_SNE_XY, // 9XY0
+		H_LD_I, // ANNN
+		H_JP_V0, // BNNN
+		H_RND, // CXNN
+		H_DRW, // DXYN
+		H_SKP, // EX9E
+		H_SKNP, // EXA1
+		H_LD_VX_DT, // FX07
+		H_LD_K, // FX0A
+		H_LD_DT, // FX15
+		H_LD_ST, // FX18
+		H_ADD_I, // FX1E
+		H_LD_F, // FX29
+		H_LD_B, // FX33
+		H_LD_MEM_VX, // FX55
+		H_LD_VX_MEM, // FX65
+		H_COUNT
+	};
+
+	// Fully decoded instruction, so the opcode only has to be taken apart once per address
+	struct Instruction
+	{
+		U8 handler;
+		U8 x;
+		U8 y;
+		U8 n;
+		U8 nn;
+		U16 nnn;
+	};
+
+	// Entry points of one instantiation of the cores, together with the quirks it was instantiated for
+	struct QuirkProfileInfo
+	{
+		bool incrementRegI;
+		bool ignorePixel;
+		bool shiftVY;
+		bool jumpVX;
+		bool resetVF;
+		bool displayWait;
+		void (Chip8::*tick)(int &remaining);
+		void (Chip8::*runSwitch)(int count);
+		void (Chip8::*runThreaded)(int count);
+		void (Chip8::*execute)(const Instruction *instruction, int &remaining);
+	};
+	template <class Q> static QuirkProfileInfo MakeQuirkProfile();
+	static const QuirkProfileInfo quirkProfiles[QUIRKS_COUNT];
+	void SelectQuirkProfile(QuirkProfile profile);
+
+	void Decode(U16 address, Instruction &instruction) const;
+	template <class Q> void TickQuirks(int &remaining);
+	template <class Q> void Execute(const Instruction *instruction, int &remaining);
+	template <class Q> void RunSwitch(int count);
+	template <class Q> void RunThreaded(int count);
+	void RunJit(int count);
+	void RunStatic(int count);
+	void InvalidateDecoded(U16 address, int count);
+	void SaveStateExceptMemory(Chip8State &state) const;
+	int SkipIdle(U16 loop, int remaining);
+
 	U8 memoryBuffer[4096] = { 0 };
 	U8 reg[16] = { 0 }; // Registers; reg[x] = VX, reg[y] = VY
 	U8 keys[16] = { 0 }; // 16 possible keys in CHIP-8 game
@@ -33,16 +259,53 @@ private:
 
 	U16 regI = 0;
 	U16 regPC = 0x200; // Program counter (program starts at 0x200)
-	U16 opcode;
 	U16 stack[16] = { 0 }; // Stack to hold subroutine data
 	U16 stackPointer = 0;
-	U16 display[64 * 32] = { 0 };
-
-	// - Fixes for two compatibilty problems -
-	// For fixing problem n1: 0xFX55 and 0xFX65 can either not modify register I, or increment it by X + 1) 
-	// The increment is required for animal race to work, but should not be there for connect 4 to work.
-	bool incrementRegI = true;
-	// For fixing problem n2: 0xDXYN can either ignore pixels that fall outside the screen, or wrap around)
-	// Pixels should be ignored for blitz to work, and wrapped around for vers to work.
-	bool ignorePixel = false;
+	U64 display[32] = { 0 }; // One word per row, column 0 in the most significant bit
+	U32 dirtyRows = 0xFFFFFFFF; // Rows changed since the last Draw(), bit n for row n
+	U32 randomState = 1; // Generator of CXNN, the rand() of the Visual C++ runtime kept per machine so that it is part of the state
+
+	// Parts of GetStateHash(), the memory chunks written since they were computed and the rows they were computed from
+	mutable U64 memoryChunkHashes[16] = { 0 };
+	mutable U64 rowHashes[32] = { 0 };
+	mutable U64 hashedRows[32] = { 0 };
+	mutable U64 memoryHash = 0;
+	mutable U64 displayHash = 0;
+	mutable U32 hashChunks = 0xFFFF;
+	mutable bool displayHashed = false;
+
+	// Chunks of the fork saved or loaded last and the memory chunks written since, bit n for addresses n * 256 and up
+	std::shared_ptr<const Chip8ForkChunk> forkChunks[FORK_CHUNK_COUNT];
+	U32 forkWrittenChunks = 0xFFFF;
+
+	// Memory chunks written since the last UpdateState()
+	mutable U32 stateChunks = 0xFFFF;
+
+	// Decoded instruction for every address, filled in the first time the address is executed
+	// Writes to memory (FX33, FX55) clear the entries they overlap
+	Instruction decodeCache[4096] = {};
+
+	Core core = CORE_SWITCH;
+	std::unique_ptr<Chip8Jit> jit; // Created the first time CORE_JIT runs
+	const RecompiledProgram *recompiled = nullptr; // Generated code for the loaded ROM, if any
+
+	const QuirkProfileInfo *quirks = &quirkProfiles[QUIRKS_DEFAULT];
+	bool quirksFromChecksum = true; // False once SetQuirkProfile() was called
+	bool waitForFrame = false; // Set by DXYN when the profile has displayWait, ends Run()
+
+	// Idle loop detection, see SkipIdle()
+	static const U16 NO_IDLE_LOOP = 0xFFFF;
+	U16 idleLoop = NO_IDLE_LOOP; // Target of the last backward jump, NO_IDLE_LOOP after an operation with side effects
+	int idleRemaining = 0; // Instructions that were left in the batch at that jump
+	U8 idleReg[16] = { 0 }; // Machine state at that jump
+	U16 idleRegI = 0;
+	U16 idleStack[16] = { 0 };
+	U16 idleStackPointer = 0;
+	U8 idleDelayTimer = 0;
+	int idleLength = 0; // Instructions per iteration of the loop the machine spins in, 0 when it is not idle
+
+#ifdef CHIP8_PROFILE
+	void RunProfiled(int count);
+	Chip8Profiler *profiler = nullptr;
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,382 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen
+#include "Chip8Audio.h"
+#include "Chip8Trace.h"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <mmsystem.h>
+#elif defined(CHIP8_AUDIO_PULSE)
+#include <pulse/simple.h>
+#elif defined(CHIP8_AUDIO_ALSA)
+#include <alsa/asoundlib.h>
+#endif
+
+namespace
+{
+	const int sampleRate = 44100;
+	const int blockSize = 441; // Samples the output thread hands to the sink at once, 10 ms
+	const int toneFrequency = 523; // Same pitch as the Beep() this replaces
+	const short toneVolume = 6000;
+	const int fadeSamples = 64; // Ramp when the tone starts or stops, avoids clicks
+
+	void WriteLittleEndian(FILE *file, unsigned int value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+		{
+			fputc((value >> (i * 8)) & 0xFF, file);
+		}
+	}
+}
+
+bool NullAudioSink::Open(int)
+{
+	return true;
+}
+
+void NullAudioSink::Write(const short *, int)
+{
+}
+
+WavAudioSink::WavAudioSink(const char *path) : path(path)
+{
+}
+
+WavAudioSink::~WavAudioSink()
+{
+	if (file)
+	{
+		WriteHeader(); // Now with the final sizes
+		fclose(file);
+	}
+}
+
+bool WavAudioSink::Open(int rate)
+{
+	sampleRate = rate;
+	file = fopen(path, "wb");
+	if (file == NULL) return false;
+
+	WriteHeader();
+	return true;
+}
+
+void WavAudioSink::Write(const short *samples, int count)
+{
+	if (file == NULL) return;
+
+	for (int i = 0; i < count; i++)
+	{
+		WriteLittleEndian(file, (unsigned short)samples[i], 2);
+	}
+	dataSize += count * 2;
+}
+
+void WavAudioSink::WriteHeader()
+{
+	fseek(file, 0, SEEK_SET);
+	fwrite("RIFF", 1, 4, file);
+	WriteLittleEndian(file, 36 + dataSize, 4);
+	fwrite("WAVEfmt ", 1, 8, file);
+	WriteLittleEndian(file, 16, 4); // Size of the format chunk
+	WriteLittleEndian(file, 1, 2); // PCM
+	WriteLittleEndian(file, 1, 2); // Mono
+	WriteLittleEndian(file, sampleRate, 4);
+	WriteLittleEndian(file, sampleRate * 2, 4); // Bytes per second
+	WriteLittleEndian(file, 2, 2); // Bytes per sample
+	WriteLittleEndian(file, 16, 2); // Bits per sample
+	fwrite("data", 1, 4, file);
+	WriteLittleEndian(file, dataSize, 4);
+	fseek(file, 0, SEEK_END);
+}
+
+#if defined(_WIN32)
+namespace
+{
+	class WaveOutAudioSink : public AudioSink
+	{
+	public:
+		~WaveOutAudioSink() override
+		{
+			if (device == NULL) return;
+
+			waveOutReset(device);
+			for (int i = 0; i < bufferCount; i++)
+			{
+				if (headers[i].dwFlags & WHDR_PREPARED) waveOutUnprepareHeader(device, &headers[i], sizeof(WAVEHDR));
+			}
+			waveOutClose(device);
+			CloseHandle(done);
+		}
+
+		bool Open(int sampleRate) override
+		{
+			WAVEFORMATEX format = {};
+			format.wFormatTag = WAVE_FORMAT_PCM;
+			format.nChannels = 1;
+			format.nSamplesPerSec = sampleRate;
+			format.wBitsPerSample = 16;
+			format.nBlockAlign = 2;
+			format.nAvgBytesPerSec = sampleRate * 2;
+
+			done = CreateEvent(NULL, FALSE, FALSE, NULL);
+			if (waveOutOpen(&device, WAVE_MAPPER, &format, (DWORD_PTR)done, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+			{
+				device = NULL;
+				CloseHandle(done);
+				return false;
+			}
+			memset(headers, 0, sizeof(headers));
+			return true;
+		}
+
+		void Write(const short *samples, int count) override
+		{
+			while (count > 0)
+			{
+				// Wait until the device is done with the next buffer of the ring
+				WAVEHDR &header = headers[next];
+				while ((header.dwFlags & WHDR_PREPARED) && !(header.dwFlags & WHDR_DONE))
+				{
+					WaitForSingleObject(done, 100);
+				}
+				if (header.dwFlags & WHDR_PREPARED) waveOutUnprepareHeader(device, &header, sizeof(WAVEHDR));
+
+				int size = count < bufferSize ? count : bufferSize;
+				memcpy(buffers[next], samples, size * sizeof(short));
+				header.lpData = (LPSTR)buffers[next];
+				header.dwBufferLength = size * sizeof(short);
+				header.dwFlags = 0;
+				waveOutPrepareHeader(device, &header, sizeof(WAVEHDR));
+				waveOutWrite(device, &header, sizeof(WAVEHDR));
+
+				next = (next + 1) % bufferCount;
+				samples += size;
+				count -= size;
+			}
+		}
+
+		bool IsRealTime() const override { return true; }
+
+	private:
+		static const int bufferCount = 4;
+		static const int bufferSize = 1024;
+
+		HWAVEOUT device = NULL;
+		HANDLE done = NULL;
+		WAVEHDR headers[bufferCount];
+		short buffers[bufferCount][bufferSize];
+		int next = 0;
+	};
+}
+
+AudioSink *CreateSystemAudioSink()
+{
+	return new WaveOutAudioSink();
+}
+#elif defined(CHIP8_AUDIO_PULSE)
+namespace
+{
+	class PulseAudioSink : public AudioSink
+	{
+	public:
+		~PulseAudioSink() override
+		{
+			if (stream) pa_simple_free(stream);
+		}
+
+		bool Open(int sampleRate) override
+		{
+			pa_sample_spec spec;
+			spec.format = PA_SAMPLE_S16LE;
+			spec.rate = sampleRate;
+			spec.channels = 1;
+			stream = pa_simple_new(NULL, "PDevEmulator", PA_STREAM_PLAYBACK, NULL, "CHIP-8", &spec, NULL, NULL, NULL);
+			return stream != NULL;
+		}
+
+		void Write(const short *samples, int count) override
+		{
+			pa_simple_write(stream, samples, count * sizeof(short), NULL);
+		}
+
+		bool IsRealTime() const override { return true; }
+
+	private:
+		pa_simple *stream = nullptr;
+	};
+}
+
+AudioSink *CreateSystemAudioSink()
+{
+	return new PulseAudioSink();
+}
+#elif defined(CHIP8_AUDIO_ALSA)
+namespace
+{
+	class AlsaAudioSink : public AudioSink
+	{
+	public:
+		~AlsaAudioSink() override
+		{
+			if (pcm)
+			{
+				snd_pcm_drain(pcm);
+				snd_pcm_close(pcm);
+			}
+		}
+
+		bool Open(int sampleRate) override
+		{
+			if (snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0)
+			{
+				pcm = nullptr;
+				return false;
+			}
+			// 50 ms of buffering in the device
+			return snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, 1, sampleRate, 1, 50000) >= 0;
+		}
+
+		void Write(const short *samples, int count) override
+		{
+			while (count > 0)
+			{
+				snd_pcm_sframes_t written = snd_pcm_writei(pcm, samples, count);
+				if (written < 0)
+				{
+					if (snd_pcm_recover(pcm, (int)written, 1) < 0) return; // Underrun or suspend, otherwise give up on this block
+					continue;
+				}
+				samples += written;
+				count -= (int)written;
+			}
+		}
+
+		bool IsRealTime() const override { return true; }
+
+	private:
+		snd_pcm_t *pcm = nullptr;
+	};
+}
+
+AudioSink *CreateSystemAudioSink()
+{
+	return new AlsaAudioSink();
+}
+#else
+AudioSink *CreateSystemAudioSink()
+{
+	return new NullAudioSink();
+}
+#endif
+
+Chip8Audio::Chip8Audio()
+{
+}
+
+Chip8Audio::~Chip8Audio()
+{
+	Stop();
+}
+
+bool Chip8Audio::Start(AudioSink *s)
+{
+	Stop();
+
+	sink.reset(s);
+	if (!sink->Open(sampleRate))
+	{
+		sink.reset();
+		return false;
+	}
+
+	running = true;
+	generator = std::thread(&Chip8Audio::Generate, this);
+	output = std::thread(&Chip8Audio::Output, this);
+	return true;
+}
+
+void Chip8Audio::Stop()
+{
+	running = false;
+	if (generator.joinable()) generator.join();
+	if (output.joinable()) output.join();
+	sink.reset();
+}
+
+void Chip8Audio::SetTone(bool on)
+{
+	tone.store(on, std::memory_order_relaxed);
+}
+
+void Chip8Audio::Generate()
+{
+	Chip8Trace::SetThreadName("Audio generator");
+
+	// Square wave with a short linear fade in and out
+	int phase = 0; // Position in the period, in units of 1 / (2 * sampleRate) periods
+	int level = 0; // 0..fadeSamples
+	short sample = 0;
+	bool pending = false; // sample did not fit in the ring buffer yet
+
+	while (running)
+	{
+		for (;;)
+		{
+			if (!pending)
+			{
+				bool on = tone.load(std::memory_order_relaxed);
+				if (on && level < fadeSamples) level++;
+				else if (!on && level > 0) level--;
+
+				phase = (phase + toneFrequency * 2) % (sampleRate * 2);
+				sample = (short)((phase < sampleRate ? toneVolume : -toneVolume) * level / fadeSamples);
+				pending = true;
+			}
+			if (!samples.Push(sample))
+			{
+				break; // Ring buffer full, try again later
+			}
+			pending = false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+}
+
+void Chip8Audio::Output()
+{
+	Chip8Trace::SetThreadName("Audio output");
+
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration blockTime = std::chrono::microseconds(1000000LL * blockSize / sampleRate);
+
+	short block[blockSize];
+	Clock::time_point nextBlock = Clock::now();
+
+	while (running)
+	{
+		int count = 0;
+		while (count < blockSize && samples.Pop(block[count]))
+		{
+			count++;
+		}
+		if (count < blockSize) // The generator fell behind, fill up with silence rather than waiting
+		{
+			memset(block + count, 0, (blockSize - count) * sizeof(short));
+		}
+
+		{
+			Chip8Trace::Scope trace("Audio write");
+			sink->Write(block, blockSize);
+		}
+
+		// Sound devices block in Write(), the others are paced by the clock
+		if (!sink->IsRealTime())
+		{
+			nextBlock += blockTime;
+			std::this_thread::sleep_until(nextBlock);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include "SpscQueue.h"
+
+// Destination of the synthesized sound, 16-bit signed mono samples
+class AudioSink
+{
+public:
+	virtual ~AudioSink() {}
+
+	virtual bool Open(int sampleRate) = 0;
+	virtual void Write(const short *samples, int count) = 0; // May block until the device has room
+	virtual bool IsRealTime() const = 0; // Write() itself keeps pace with the sample rate (a sound device)
+};
+
+// Discards everything, for headless runs and machines without sound
+class NullAudioSink : public AudioSink
+{
+public:
+	bool Open(int sampleRate) override;
+	void Write(const short *samples, int count) override;
+	bool IsRealTime() const override { return false; }
+};
+
+// Records everything to a .wav file
+class WavAudioSink : public AudioSink
+{
+public:
+	WavAudioSink(const char *path);
+	~WavAudioSink() override;
+
+	bool Open(int sampleRate) override;
+	void Write(const short *samples, int count) override;
+	bool IsRealTime() const override { return false; }
+
+private:
+	void WriteHeader();
+
+	const char *path;
+	FILE *file = nullptr;
+	int sampleRate = 0;
+	unsigned int dataSize = 0;
+};
+
+// The sound device: waveOut on Windows, PulseAudio or ALSA when built with CHIP8_AUDIO_PULSE or CHIP8_AUDIO_ALSA
+// Falls back to a NullAudioSink when there is none
+AudioSink *CreateSystemAudioSink();
+
+// The CHIP-8 buzzer
+// A generator thread synthesizes the tone into a lock-free ring buffer and an output thread feeds that to the sink,
+// the emulator only ever sets an atomic flag, so it never waits for sound
+class Chip8Audio
+{
+public:
+	Chip8Audio();
+	~Chip8Audio();
+	Chip8Audio(const Chip8Audio &) = delete;
+	Chip8Audio &operator=(const Chip8Audio &) = delete;
+
+	bool Start(AudioSink *sink); // Takes ownership of the sink, false when it could not be opened
+	void Stop();
+
+	void SetTone(bool on); // Called from the emulation thread
+
+private:
+	void Generate();
+	void Output();
+
+	std::unique_ptr<AudioSink> sink;
+	std::thread generator;
+	std::thread output;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> tone{ false };
+
+	SpscQueue<short, 2048> samples; // About 45 ms, the latency between SetTone() and the sink
+};
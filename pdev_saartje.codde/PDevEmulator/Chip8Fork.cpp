@@ -0,0 +1,40 @@
+#include "Chip8Fork.h"
+
+#include <cstring>
+
+static_assert(Chip8Fork::CHUNK_COUNT == Chip8::FORK_CHUNK_COUNT, "Chip8 keeps one chunk pointer per chunk of a fork");
+static_assert(Chip8Fork::CHUNK_SIZE == sizeof(U64) * 32, "The display is one chunk");
+
+void Chip8Fork::GetState(Chip8State &state) const
+{
+	memset(&state, 0, sizeof(Chip8State));
+	if (IsEmpty()) return;
+
+	for (int i = 0; i < MEMORY_CHUNKS; i++)
+	{
+		memcpy(&state.memory[i * CHUNK_SIZE], chunks[i]->bytes, CHUNK_SIZE);
+	}
+	memcpy(state.display, chunks[DISPLAY_CHUNK]->bytes, CHUNK_SIZE);
+	memcpy(state.stack, registers.stack, sizeof(state.stack));
+	state.regI = registers.regI;
+	state.regPC = registers.regPC;
+	state.stackPointer = registers.stackPointer;
+	memcpy(state.reg, registers.reg, sizeof(state.reg));
+	memcpy(state.keys, registers.keys, sizeof(state.keys));
+	state.keyPress = registers.keyPress;
+	state.delayTimer = registers.delayTimer;
+	state.soundTimer = registers.soundTimer;
+	state.quirkProfile = quirkProfile;
+	state.quirksFromChecksum = quirksFromChecksum ? 1 : 0;
+	state.randomState = registers.randomState;
+}
+
+int Chip8Fork::CountSharedChunks(const Chip8Fork &other) const
+{
+	int shared = 0;
+	for (int i = 0; i < CHUNK_COUNT; i++)
+	{
+		if (chunks[i] && chunks[i] == other.chunks[i]) shared++;
+	}
+	return shared;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+
+#include "Chip8.h"
+
+// 256 bytes of memory, or the 32 rows of the display
+struct Chip8ForkChunk
+{
+	U8 bytes[256];
+};
+
+// Snapshot of a machine for search and what-if runs, made by Chip8::SaveFork() and run again by Chip8::LoadFork()
+// Memory and display are kept in 256-byte chunks shared by every fork that has the same contents, the rest is a few
+// registers: copying a Chip8Fork copies no memory at all, and SaveFork() only copies the chunks the machine wrote
+// since the fork it last saved or loaded. Branching one state on every key is then
+//   for each key: chip8.LoadFork(parent); chip8.SetKey(key, true); run a frame; chip8.SaveFork(child[key]);
+// where the loads only copy the chunks the previous child wrote, and the children share everything else with parent
+class Chip8Fork
+{
+public:
+	static const int CHUNK_SIZE = sizeof(Chip8ForkChunk);
+	static const int MEMORY_CHUNKS = 4096 / CHUNK_SIZE;
+	static const int DISPLAY_CHUNK = MEMORY_CHUNKS; // 32 rows of 8 bytes are exactly one chunk
+	static const int CHUNK_COUNT = MEMORY_CHUNKS + 1;
+
+	bool IsEmpty() const { return !chunks[0]; } // Not saved from a machine yet
+	void GetState(Chip8State &state) const; // Everything in one savestate
+	int CountSharedChunks(const Chip8Fork &other) const; // Chunks both forks use without a copy of their own
+
+private:
+	friend class Chip8;
+
+	std::shared_ptr<const Chip8ForkChunk> chunks[CHUNK_COUNT];
+
+	Chip8Registers registers = {};
+	U8 quirkProfile = 0; // Chip8::QuirkProfile
+	bool quirksFromChecksum = true;
+};
@@ -0,0 +1,784 @@
+#include "Chip8Jit.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CHIP8_JIT_X64
+#endif
+
+#if defined(CHIP8_JIT_X64) && defined(_WIN32)
+#include <Windows.h>
+#elif defined(CHIP8_JIT_X64)
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	const int codeCapacity = 512 * 1024;
+	const int reserveBytes = 16 * 1024; // Compile() starts over below this much free space
+	const int maxBlockLength = 64; // Instructions per block
+	const int maxInstructionBytes = 1024; // More than the machine code of any one instruction, FX65 with a full side exit included
+	const int maxBlocksAhead = 64; // Blocks compiled by one Compile(), the one asked for and those it leads to
+	const int maxPending = 256;
+	const int maxExitBytes = 256; // More than the code that leaves a block when count runs out before an instruction
+
+	// Registers of the generated code:
+	// rbx holds the address of reg[0] and ebp what is left of count, they survive calls; eax and edx are scratch
+	// and the others hold V0-VF and I within a block
+	const int RAX = 0;
+	const int RDX = 2;
+	const int RBX = 3;
+	const int pool[] = { 1, 6, 7, 8, 9, 10, 11 }; // rcx, rsi, rdi, r8-r11
+	const int poolSize = sizeof(pool) / sizeof(pool[0]);
+	const int VI = 16; // Index of I after V0-VF
+
+	// Minimal x86-64 encoder, memory operands are [rbx + disp32] or [rbx + rax * scale + disp32]
+	struct Emitter
+	{
+		U8 *code;
+
+		void Byte(U8 b) { *code++ = b; }
+		void Word(U16 w) { Byte(w & 0xFF); Byte(w >> 8); }
+		void Dword(int d) { for (int i = 0; i < 4; i++) Byte((d >> (i * 8)) & 0xFF); }
+		void Qword(U64 q) { for (int i = 0; i < 8; i++) Byte((q >> (i * 8)) & 0xFF); }
+
+		// REX prefix for register r in the reg field and b in the r/m field; byte operands always get one,
+		// so that 4-7 are spl-dil instead of ah-bh
+		void Rex(bool wide, int r, int b, bool bytes)
+		{
+			U8 rex = 0x40 | (wide ? 8 : 0) | ((r >> 3) << 2) | (b >> 3);
+			if (bytes || rex != 0x40) Byte(rex);
+		}
+		void Reg(U8 opcode, int r, int rm, bool bytes) { Rex(false, r, rm, bytes); Byte(opcode); Byte(0xC0 | ((r & 7) << 3) | (rm & 7)); }
+		void Reg2(U8 opcode1, int r, int rm, bool bytes) { Rex(false, r, rm, bytes); Byte(0x0F); Byte(opcode1); Byte(0xC0 | ((r & 7) << 3) | (rm & 7)); }
+		void Mem(U8 opcode, int r, int disp, bool bytes) { Rex(false, r, 0, bytes); Byte(opcode); Byte(0x80 | ((r & 7) << 3) | RBX); Dword(disp); }
+		void Mem2(U8 opcode1, int r, int disp) { Rex(false, r, 0, false); Byte(0x0F); Byte(opcode1); Byte(0x80 | ((r & 7) << 3) | RBX); Dword(disp); }
+		void Indexed(U8 opcode, int r, int scale, int disp, bool bytes) // [rbx + rax << scale + disp]
+		{
+			Rex(false, r, 0, bytes); Byte(opcode); Byte(0x84 | ((r & 7) << 3)); Byte((scale << 6) | (RAX << 3) | RBX); Dword(disp);
+		}
+
+		void StoreWord(int disp, U16 value) { Byte(0x66); Mem(0xC7, 0, disp, false); Word(value); } // mov word [rbx + disp], value
+
+		U8 *Jcc(U8 condition) { Byte(0x0F); Byte(0x80 | condition); Dword(0); return code - 4; } // Target set by Patch()
+		U8 *Jmp() { Byte(0xE9); Dword(0); return code - 4; }
+		void Jmp(const U8 *target) { Patch(Jmp(), target); }
+		static void Patch(U8 *rel, const U8 *target) { int d = (int)(target - (rel + 4)); memcpy(rel, &d, 4); }
+	};
+
+	const U8 JE = 0x4;
+	const U8 JNE = 0x5;
+	const U8 JBE = 0x6;
+	const U8 JA = 0x7;
+	const U8 JS = 0x8;
+
+	// Which host register holds which of V0-VF and I, loaded on first use and stored back before the block leaves
+	struct RegisterCache
+	{
+		Emitter &e;
+		int offsetI;
+		int host[17]; // Host register of V0-VF and I, -1 when not loaded
+		int value[16]; // What every host register holds, -1 when free
+		bool dirty[17];
+		U32 locked = 0; // Operands of the instruction being translated, not to be spilled
+		int victim = 0;
+
+		RegisterCache(Emitter &e, int offsetI) : e(e), offsetI(offsetI)
+		{
+			for (int i = 0; i < 17; i++) { host[i] = -1; dirty[i] = false; }
+			for (int i = 0; i < 16; i++) value[i] = -1;
+		}
+
+		void Load(int v, int h)
+		{
+			if (v == VI) e.Mem2(0xB7, h, offsetI); // movzx h, word [I]
+			else e.Mem(0x8A, h, v, true); // mov h, [VX]
+		}
+		void Store(int v)
+		{
+			if (v == VI) { e.Byte(0x66); e.Mem(0x89, host[v], offsetI, false); } // mov [I], h16
+			else e.Mem(0x88, host[v], v, true); // mov [VX], h
+		}
+		void StoreDirty() // Before every exit, the values stay in their registers
+		{
+			for (int v = 0; v < 17; v++)
+			{
+				if (dirty[v]) Store(v);
+			}
+		}
+
+		int Get(int v, bool load)
+		{
+			locked |= 1u << v;
+			if (host[v] >= 0) return host[v];
+
+			int h = -1;
+			for (int i = 0; i < poolSize && h < 0; i++)
+			{
+				if (value[pool[i]] < 0) h = pool[i];
+			}
+			while (h < 0)
+			{
+				int candidate = pool[victim];
+				victim = (victim + 1) % poolSize;
+				int old = value[candidate];
+				if (locked & (1u << old)) continue;
+				if (dirty[old]) Store(old);
+				dirty[old] = false;
+				host[old] = -1;
+				h = candidate;
+			}
+			host[v] = h;
+			value[h] = v;
+			if (load) Load(v, h);
+			return h;
+		}
+		void Forget() // After a call, which may change them and does not keep the registers
+		{
+			for (int i = 0; i < 17; i++) { host[i] = -1; dirty[i] = false; }
+			for (int i = 0; i < 16; i++) value[i] = -1;
+		}
+		int Read(int v) { return Get(v, true); }
+		int Modify(int v) { dirty[v] = true; return Get(v, true); }
+		int Write(int v) { dirty[v] = true; return Get(v, false); }
+	};
+}
+
+Chip8Jit::Chip8Jit(Chip8 &chip8) : chip8(chip8)
+{
+#if defined(CHIP8_JIT_X64) && defined(_WIN32)
+	codeBuffer = (U8 *)VirtualAlloc(NULL, codeCapacity, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#elif defined(CHIP8_JIT_X64)
+	void *memory = mmap(NULL, codeCapacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	codeBuffer = memory == MAP_FAILED ? nullptr : (U8 *)memory;
+#endif
+	if (codeBuffer == nullptr) return;
+
+	entries = (const U8 **)codeBuffer;
+	Emitter e = { codeBuffer + 4096 * sizeof(U8 *) };
+
+	// int enter(U8 *reg, int count, const U8 *block): save the registers the caller keeps, then jump to the block
+	enter = (EnterFunction)e.code;
+#if defined(_WIN32)
+	const U8 saved[] = { 3, 5, 6, 7 }; // rbx, rbp and rsi, rdi, which the caller keeps in them on Windows
+#else
+	const U8 saved[] = { 3, 5 }; // rbx, rbp
+#endif
+	for (U8 r : saved)
+	{
+		e.Rex(false, 0, r, false); e.Byte(0x50 | (r & 7)); // push r
+	}
+	e.Byte(0x48); e.Byte(0x83); e.Byte(0xEC); e.Byte(40); // sub rsp, 40: aligned for calls, with the shadow space of Windows
+#if defined(_WIN32)
+	e.Byte(0x48); e.Byte(0x89); e.Byte(0xCB); // mov rbx, rcx
+	e.Byte(0x89); e.Byte(0xD5); // mov ebp, edx
+	e.Byte(0x41); e.Byte(0xFF); e.Byte(0xE0); // jmp r8
+#else
+	e.Byte(0x48); e.Byte(0x89); e.Byte(0xFB); // mov rbx, rdi
+	e.Byte(0x89); e.Byte(0xF5); // mov ebp, esi
+	e.Byte(0xFF); e.Byte(0xE2); // jmp rdx
+#endif
+
+	// A jump to an address without a block: program counter = ax and leave
+	missStub = e.code;
+	e.Byte(0x66); e.Mem(0x89, RAX, (int)((U8 *)&chip8.regPC - chip8.reg), false); // mov [PC], ax
+
+	exitStub = e.code;
+	e.Byte(0x89); e.Byte(0xE8); // mov eax, ebp
+	e.Byte(0x48); e.Byte(0x83); e.Byte(0xC4); e.Byte(40); // add rsp, 40
+	for (int i = sizeof(saved) - 1; i >= 0; i--)
+	{
+		e.Rex(false, 0, saved[i], false); e.Byte(0x58 | (saved[i] & 7)); // pop r
+	}
+	e.Byte(0xC3); // ret
+
+	fixedSize = (int)(e.code - codeBuffer);
+	Flush();
+}
+
+Chip8Jit::~Chip8Jit()
+{
+#if defined(CHIP8_JIT_X64) && defined(_WIN32)
+	if (codeBuffer) VirtualFree(codeBuffer, 0, MEM_RELEASE);
+#elif defined(CHIP8_JIT_X64)
+	if (codeBuffer) munmap(codeBuffer, codeCapacity);
+#endif
+}
+
+int Chip8Jit::Execute(int count)
+{
+	U16 pc = chip8.regPC;
+	if (codeBuffer == nullptr || pc > 0x0FFD) return 0;
+
+	if (!compiled[pc])
+	{
+		Compile(pc);
+	}
+	if (writable)
+	{
+		SetWritable(false);
+	}
+
+	running = true;
+	int left = enter(chip8.reg, count, entries[pc]);
+	running = false;
+	if (stale)
+	{
+		Flush();
+	}
+	return count - left;
+}
+
+void Chip8Jit::SetWritable(bool write)
+{
+	writable = write;
+#if defined(CHIP8_JIT_X64) && defined(_WIN32)
+	DWORD previous;
+	VirtualProtect(codeBuffer, codeCapacity, write ? PAGE_READWRITE : PAGE_EXECUTE_READ, &previous);
+	if (!write) FlushInstructionCache(GetCurrentProcess(), codeBuffer, codeCapacity);
+#elif defined(CHIP8_JIT_X64)
+	mprotect(codeBuffer, codeCapacity, write ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC);
+#endif
+}
+
+int Chip8Jit::Interpret(Chip8Jit *jit, U16 address, int remaining)
+{
+	Chip8 &chip8 = jit->chip8;
+	U32 flushes = jit->flushes;
+	U16 next = address + 2;
+	chip8.regPC = next;
+	(chip8.*chip8.quirks->execute)(&jit->decoded[address], remaining);
+	// Carry on unless the code was thrown away, the frame ended or the operation jumped (BNNN, FX0A without a key)
+	return jit->flushes == flushes && !chip8.waitForFrame && chip8.regPC == next;
+}
+
+int Chip8Jit::Loop(Chip8Jit *jit, U16 loop, int remaining)
+{
+	return jit->chip8.SkipIdle(loop, remaining);
+}
+
+void Chip8Jit::Invalidate(U16 address, int count)
+{
+	for (int i = address; i < address + count; i++)
+	{
+		if (covered[i & 0x0FFF])
+		{
+			// Self-modifying code, simply start over; from within the generated code only once it has returned
+			if (running)
+			{
+				stale = true;
+				flushes++;
+				return;
+			}
+			Flush();
+			return;
+		}
+	}
+}
+
+void Chip8Jit::Flush()
+{
+	if (codeBuffer == nullptr) return;
+
+	if (!writable)
+	{
+		SetWritable(true);
+	}
+	stale = false;
+	codeSize = fixedSize;
+	flushes++;
+	for (int i = 0; i < 4096; i++)
+	{
+		entries[i] = missStub;
+	}
+	memset(compiled, 0, sizeof(compiled));
+	memset(covered, 0, sizeof(covered));
+}
+
+void Chip8Jit::Compile(U16 address)
+{
+	if (codeSize + reserveBytes > codeCapacity)
+	{
+		Flush();
+	}
+	if (!writable)
+	{
+		SetWritable(true);
+	}
+
+	// The blocks it goes on to are compiled along with it, so the code buffer changes protection less often;
+	// only the first may start over when the buffer is full, that would drop the others
+	U16 pending[maxPending];
+	int pendingCount = 0;
+	CompileBlock(address, pending, pendingCount);
+	for (int blocks = 1; pendingCount > 0 && blocks < maxBlocksAhead && codeSize + reserveBytes <= codeCapacity; )
+	{
+		U16 next = pending[--pendingCount];
+		if (!compiled[next])
+		{
+			CompileBlock(next, pending, pendingCount);
+			blocks++;
+		}
+	}
+}
+
+void Chip8Jit::CompileBlock(U16 address, U16 *pending, int &pendingCount)
+{
+	compiled[address] = true;
+
+	// Displacements of the other state relative to reg[0]
+	const int I = (int)((U8 *)&chip8.regI - chip8.reg);
+	const int PC = (int)((U8 *)&chip8.regPC - chip8.reg);
+	const int SP = (int)((U8 *)&chip8.stackPointer - chip8.reg);
+	const int STACK = (int)((U8 *)chip8.stack - chip8.reg);
+	const int KEYS = (int)(chip8.keys - chip8.reg);
+	const int KEYPRESS = (int)(&chip8.keyPress - chip8.reg);
+	const int MEMORY = (int)(chip8.memoryBuffer - chip8.reg);
+	const int DT = (int)(&chip8.delayTimer - chip8.reg);
+	const int ST = (int)(&chip8.soundTimer - chip8.reg);
+	const int DISPLAY = (int)((U8 *)chip8.display - chip8.reg);
+	const int DIRTY = (int)((U8 *)&chip8.dirtyRows - chip8.reg);
+	const int IDLE = (int)((U8 *)&chip8.idleLoop - chip8.reg);
+	const int WAIT = (int)((U8 *)&chip8.waitForFrame - chip8.reg);
+	const int VF = 0xF;
+
+	U8 *start = codeBuffer + codeSize;
+	Emitter e = { start };
+	RegisterCache cache(e, I);
+
+	// Leave for Execute() with the program counter at target
+	auto leave = [&](U16 target)
+	{
+		e.StoreWord(PC, target);
+		e.Jmp(exitStub);
+	};
+	// Leave for the block at target through the entry table: mov eax, target; jmp [entries + target * 8]
+	auto chain = [&](U16 target)
+	{
+		if (target > 0x0FFD)
+		{
+			leave(target);
+			return;
+		}
+		e.Byte(0xB8); e.Dword(target);
+		e.Byte(0xFF); e.Byte(0x25); e.Dword((int)((const U8 *)&entries[target] - (e.code + 4)));
+		if (!compiled[target] && pendingCount < maxPending)
+		{
+			pending[pendingCount++] = target;
+		}
+	};
+	// Every instruction takes one off count first and leaves before it runs when there is none left,
+	// those exits are placed after the block with the registers that are dirty at that point
+	struct Exit
+	{
+		U8 *jump;
+		U16 pc;
+		int host[17];
+		bool dirty[17];
+	};
+	Exit exits[maxBlockLength];
+	int instructions = 0;
+	// function(this, address, what is left of count), with V0-VF and I in memory, they are not kept in registers across it
+	auto call = [&](int (*function)(Chip8Jit *, U16, int), U16 address)
+	{
+		cache.StoreDirty();
+		cache.Forget();
+#if defined(_WIN32)
+		e.Byte(0x48); e.Byte(0xB9); e.Qword((U64)this); // mov rcx, this
+		e.Byte(0xBA); e.Dword(address); // mov edx, address
+		e.Byte(0x41); e.Byte(0x89); e.Byte(0xE8); // mov r8d, ebp
+#else
+		e.Byte(0x48); e.Byte(0xBF); e.Qword((U64)this); // mov rdi, this
+		e.Byte(0xBE); e.Dword(address); // mov esi, address
+		e.Byte(0x89); e.Byte(0xEA); // mov edx, ebp
+#endif
+		e.Byte(0x48); e.Byte(0xB8); e.Qword((U64)function); // mov rax, function
+		e.Byte(0xFF); e.Byte(0xD0); // call rax
+		e.Byte(0x85); e.Byte(0xC0); // test eax, eax
+	};
+	// Not translated: Interpret() runs the operation through the interpreter
+	auto interpret = [&](U16 at)
+	{
+		call(&Interpret, at);
+		U8 *carryOn = e.Jcc(JNE);
+		e.Jmp(exitStub);
+		Emitter::Patch(carryOn, e.code);
+	};
+	// Back to target, which may be an idle loop, like the interpreter: count = Chip8::SkipIdle(target, count)
+	auto loop = [&](U16 target)
+	{
+		call(&Loop, target);
+		e.Byte(0x89); e.Byte(0xC5); // mov ebp, eax
+		U8 *carryOn = e.Jcc(JNE);
+		leave(target);
+		Emitter::Patch(carryOn, e.code);
+		chain(target);
+	};
+
+	U16 pc = address;
+	bool terminated = false;
+
+	while (!terminated)
+	{
+		if (instructions == maxBlockLength || pc > 0x0FFD ||
+			e.code - codeBuffer + maxInstructionBytes + (instructions + 1) * maxExitBytes > codeCapacity)
+		{
+			cache.StoreDirty();
+			chain(pc);
+			break;
+		}
+
+		Exit &exit = exits[instructions];
+		exit.pc = pc;
+		memcpy(exit.host, cache.host, sizeof(exit.host));
+		memcpy(exit.dirty, cache.dirty, sizeof(exit.dirty));
+		e.Byte(0xFF); e.Byte(0xCD); // dec ebp
+		exit.jump = e.Jcc(JS);
+
+		Chip8::Instruction &in = decoded[pc];
+		chip8.Decode(pc, in);
+		const int X = in.x;
+		const int Y = in.y;
+		U16 next = pc + 2;
+		cache.locked = 0;
+
+		switch (in.handler)
+		{
+		case Chip8::H_LD_NN: // mov VX, NN
+		{
+			int x = cache.Write(X);
+			e.Rex(false, 0, x, true); e.Byte(0xB0 | (x & 7)); e.Byte(in.nn);
+			break;
+		}
+		case Chip8::H_ADD_NN: // add VX, NN
+		{
+			int x = cache.Modify(X);
+			e.Reg(0x80, 0, x, true); e.Byte(in.nn);
+			break;
+		}
+		case Chip8::H_LD_XY: // mov VX, VY
+		{
+			int y = cache.Read(Y);
+			int x = cache.Write(X);
+			e.Reg(0x88, y, x, true);
+			break;
+		}
+		case Chip8::H_OR: // or / and / xor VX, VY
+		case Chip8::H_AND:
+		case Chip8::H_XOR:
+		{
+			int y = cache.Read(Y);
+			int x = cache.Modify(X);
+			e.Reg(in.handler == Chip8::H_OR ? 0x08 : in.handler == Chip8::H_AND ? 0x20 : 0x30, y, x, true);
+			if (chip8.quirks->resetVF)
+			{
+				int f = cache.Write(VF);
+				e.Rex(false, 0, f, true); e.Byte(0xB0 | (f & 7)); e.Byte(0); // mov VF, 0
+			}
+			break;
+		}
+		// The flag operations set VF before they write VX and read VY again after it, like Chip8Operations.inl,
+		// which matters when X or Y is F
+		case Chip8::H_ADD_XY: // VF = carry of VX + VY, then VX += VY
+		{
+			int y = cache.Read(Y);
+			int x = cache.Modify(X);
+			int f = cache.Write(VF);
+			e.Reg(0x88, x, RAX, true); e.Reg(0x00, y, RAX, true); // mov al, VX; add al, VY
+			e.Byte(0x0F); e.Byte(0x92); e.Byte(0xC2); // setc dl
+			e.Reg(0x88, RDX, f, true); // mov VF, dl
+			e.Reg(0x00, y, x, true); // add VX, VY
+			break;
+		}
+		case Chip8::H_SUB: // VF = VX >= VY, then VX -= VY
+		{
+			int y = cache.Read(Y);
+			int x = cache.Modify(X);
+			int f = cache.Write(VF);
+			e.Reg(0x38, y, x, true); // cmp VX, VY
+			e.Byte(0x0F); e.Byte(0x93); e.Byte(0xC2); // setae dl
+			e.Reg(0x88, RDX, f, true); // mov VF, dl
+			e.Reg(0x28, y, x, true); // sub VX, VY
+			break;
+		}
+		case Chip8::H_SUBN: // VF = VY >= VX, then VX = VY - VX
+		{
+			int y = cache.Read(Y);
+			int x = cache.Modify(X);
+			int f = cache.Write(VF);
+			e.Reg(0x38, x, y, true); // cmp VY, VX
+			e.Byte(0x0F); e.Byte(0x93); e.Byte(0xC2); // setae dl
+			e.Reg(0x88, RDX, f, true); // mov VF, dl
+			e.Reg(0x88, y, RAX, true); e.Reg(0x28, x, RAX, true); e.Reg(0x88, RAX, x, true); // mov al, VY; sub al, VX; mov VX, al
+			break;
+		}
+		case Chip8::H_SHR: // VF = VS & 1, then VX = VS >> 1, VS being VY or VX depending on the quirks
+		case Chip8::H_SHL: // VF = VS >> 7, then VX = VS << 1
+		{
+			int s = cache.Read(chip8.quirks->shiftVY ? Y : X);
+			int x = cache.Modify(X);
+			int f = cache.Write(VF);
+			e.Reg(0x88, s, RAX, true); // mov al, VS
+			if (in.handler == Chip8::H_SHR) { e.Byte(0x24); e.Byte(0x01); } // and al, 1
+			else { e.Byte(0xC0); e.Byte(0xE8); e.Byte(0x07); } // shr al, 7
+			e.Reg(0x88, RAX, f, true); // mov VF, al
+			e.Reg(0x88, s, RAX, true); // mov al, VS
+			e.Byte(0xD0); e.Byte(in.handler == Chip8::H_SHR ? 0xE8 : 0xE0); // shr / shl al, 1
+			e.Reg(0x88, RAX, x, true); // mov VX, al
+			break;
+		}
+		case Chip8::H_LD_I: // mov I, NNN
+		{
+			int i = cache.Write(VI);
+			e.Rex(false, 0, i, false); e.Byte(0xB8 | (i & 7)); e.Dword(in.nnn);
+			break;
+		}
+		case Chip8::H_ADD_I: // VF = I + VX > 0xFFF, then I += VX with I 16 bits wide
+		{
+			cache.Read(X);
+			int i = cache.Modify(VI);
+			int f = cache.Write(VF);
+			int x = cache.host[X];
+			e.Reg2(0xB6, RAX, x, true); // movzx eax, VX
+			e.Reg(0x01, i, RAX, false); // add eax, I
+			e.Byte(0x3D); e.Dword(0xFFF); // cmp eax, 0xFFF
+			e.Byte(0x0F); e.Byte(0x97); e.Byte(0xC2); // seta dl
+			e.Reg(0x88, RDX, f, true); // mov VF, dl
+			e.Reg2(0xB6, RAX, cache.host[X], true); // movzx eax, VX
+			e.Reg(0x01, i, RAX, false); // add eax, I
+			e.Reg2(0xB7, i, RAX, false); // movzx I, ax
+			break;
+		}
+		case Chip8::H_LD_F: // I = VX * 5
+		{
+			int x = cache.Read(X);
+			int i = cache.Write(VI);
+			e.Reg2(0xB6, RAX, x, true); // movzx eax, VX
+			e.Byte(0x8D); e.Byte(0x04); e.Byte(0x80); // lea eax, [rax + rax * 4]
+			e.Reg(0x89, RAX, i, false); // mov I, eax
+			break;
+		}
+		case Chip8::H_LD_VX_DT: // mov VX, [delayTimer]
+			e.Mem(0x8A, cache.Write(X), DT, true);
+			break;
+		case Chip8::H_LD_DT: // mov [delayTimer], VX
+			e.Mem(0x88, cache.Read(X), DT, true);
+			break;
+		case Chip8::H_LD_ST: // mov [soundTimer], VX
+			e.Mem(0x88, cache.Read(X), ST, true);
+			break;
+		case Chip8::H_LD_VX_MEM: // V0-VX = memory[I...], the interpreter does it when that runs past the end of memory
+		{
+			int i = cache.Read(VI);
+			e.Rex(false, 0, i, false); e.Byte(0x81); e.Byte(0xF8 | (i & 7)); e.Dword(0xFFF - X); // cmp I, 0xFFF - X
+			U8 *inside = e.Jcc(JBE);
+			cache.StoreDirty();
+			e.Byte(0xFF); e.Byte(0xC5); // inc ebp, it did not run
+			leave(pc);
+			Emitter::Patch(inside, e.code);
+
+			e.Reg(0x89, i, RAX, false); // mov eax, I
+			for (int v = 0; v <= X; v++)
+			{
+				cache.locked = 1u << VI;
+				e.Indexed(0x8A, cache.Write(v), 0, MEMORY + v, true); // mov Vv, [memory + rax + v]
+			}
+			if (chip8.quirks->incrementRegI)
+			{
+				e.Rex(false, 0, i, false); e.Byte(0x83); e.Byte(0xC0 | (i & 7)); e.Byte(X + 1); // add I, X + 1
+				cache.dirty[VI] = true;
+			}
+			break;
+		}
+
+		// Block terminators, they leave for the block at the next program counter
+		case Chip8::H_JP:
+			if (in.nnn < next)
+			{
+				loop(in.nnn);
+			}
+			else
+			{
+				cache.StoreDirty();
+				chain(in.nnn);
+			}
+			terminated = true;
+			break;
+		case Chip8::H_SE_NN:
+		case Chip8::H_SNE_NN:
+		case Chip8::H_SE_XY:
+		case Chip8::H_SNE_XY:
+		case Chip8::H_SKP:
+		case Chip8::H_SKNP:
+		{
+			int x = cache.Read(X);
+			int y = in.handler == Chip8::H_SE_XY || in.handler == Chip8::H_SNE_XY ? cache.Read(Y) : -1;
+			cache.StoreDirty();
+			U8 condition = JNE; // Skips when the comparison is not equal
+			if (in.handler == Chip8::H_SE_NN || in.handler == Chip8::H_SNE_NN)
+			{
+				e.Reg(0x80, 7, x, true); e.Byte(in.nn); // cmp VX, NN
+				condition = in.handler == Chip8::H_SE_NN ? JE : JNE;
+			}
+			else if (y >= 0)
+			{
+				e.Reg(0x38, y, x, true); // cmp VX, VY
+				condition = in.handler == Chip8::H_SE_XY ? JE : JNE;
+			}
+			else
+			{
+				// keys[VX] reads past the keys for VX > 15 like the interpreter does, with the program counter already advanced
+				e.StoreWord(PC, next);
+				e.Reg2(0xB6, RAX, x, true); // movzx eax, VX
+				e.Indexed(0x80, 7, 0, KEYS, false); e.Byte(0); // cmp byte [keys + rax], 0
+				condition = in.handler == Chip8::H_SKP ? JNE : JE;
+			}
+			U8 *skip = e.Jcc(condition);
+			chain(next);
+			Emitter::Patch(skip, e.code);
+			chain(next + 2);
+			terminated = true;
+			break;
+		}
+		case Chip8::H_CALL: // stack[SP & 0xF] = next; SP = (SP & 0xF) + 1
+			cache.StoreDirty();
+			e.Mem2(0xB7, RAX, SP); // movzx eax, word [SP]
+			e.Byte(0x83); e.Byte(0xE0); e.Byte(0x0F); // and eax, 0xF
+			e.Byte(0x66); e.Indexed(0xC7, 0, 1, STACK, false); e.Word(next); // mov word [stack + rax * 2], next
+			e.Byte(0xFF); e.Byte(0xC0); // inc eax
+			e.Byte(0x66); e.Mem(0x89, RAX, SP, false); // mov [SP], ax
+			chain(in.nnn);
+			terminated = true;
+			break;
+		case Chip8::H_RET: // SP = (SP - 1) & 0xF; PC = stack[SP]
+			cache.StoreDirty();
+			e.Mem2(0xB7, RAX, SP); // movzx eax, word [SP]
+			e.Byte(0xFF); e.Byte(0xC8); // dec eax
+			e.Byte(0x83); e.Byte(0xE0); e.Byte(0x0F); // and eax, 0xF
+			e.Byte(0x66); e.Mem(0x89, RAX, SP, false); // mov [SP], ax
+			e.Byte(0x0F); e.Indexed(0xB7, RAX, 1, STACK, false); // movzx eax, word [stack + rax * 2]
+			e.Byte(0x3D); e.Dword(0x0FFD); // cmp eax, 0xFFD
+			e.Patch(e.Jcc(JA), missStub); // ja missStub, no block there
+			e.Byte(0x48); e.Byte(0x8D); e.Byte(0x15); e.Dword((int)((U8 *)entries - (e.code + 4))); // lea rdx, [entries]
+			e.Byte(0xFF); e.Byte(0x24); e.Byte(0xC2); // jmp [rdx + rax * 8]
+			terminated = true;
+			break;
+
+		case Chip8::H_NOP: // Only advances the program counter
+			break;
+
+		case Chip8::H_DRW: // Like Chip8Operations.inl: rows from memory[I...] XORed onto the display, VF = 1 when a pixel was set
+		{
+			cache.StoreDirty();
+			cache.Forget(); // Uses all the registers, cl for the shifts
+			e.Mem2(0xB6, 6, X); // movzx esi, VX
+			e.Mem2(0xB6, 7, Y); // movzx edi, VY
+			e.Mem(0xC6, 0, VF, false); e.Byte(0); // mov byte [VF], 0
+			if (in.n > 0)
+			{
+				e.Byte(0x89); e.Byte(0xF1); // mov ecx, esi
+				e.Byte(0x83); e.Byte(0xE1); e.Byte(63); // and ecx, 63: the column
+				e.Byte(0x41); e.Byte(0x89); e.Byte(0xC9); // mov r9d, ecx
+				e.Byte(0xC1); e.Byte(0xEE); e.Byte(6); // shr esi, 6
+				e.Byte(0x01); e.Byte(0xF7); // add edi, esi: the row, past the right edge is the next one
+				e.Mem2(0xB7, 8, I); // movzx r8d, word [I]
+				e.Byte(0x4E); e.Byte(0x8D); e.Byte(0x84); e.Byte(0x03); e.Dword(MEMORY); // lea r8, [memory + r8]
+				e.Byte(0x4D); e.Byte(0x8D); e.Byte(0x50); e.Byte(in.n); // lea r10, [r8 + N]
+				e.Byte(0x45); e.Byte(0x31); e.Byte(0xDB); // xor r11d, r11d: rows drawn
+				// Part of the sprite row in rax on display row edi + part
+				auto plot = [&](int part)
+				{
+					e.Byte(0x48); e.Byte(0x85); e.Byte(0xC0); // test rax, rax
+					U8 *empty = e.Jcc(JE);
+					e.Byte(0x8D); e.Byte(0x77); e.Byte(part); // lea esi, [rdi + part]
+					e.Byte(0x83); e.Byte(0xFE); e.Byte(31); // cmp esi, 31
+					U8 *outside = nullptr;
+					if (chip8.quirks->ignorePixel)
+					{
+						outside = e.Jcc(JA);
+					}
+					else
+					{
+						U8 *inside = e.Jcc(JBE);
+						e.Byte(0xBE); e.Dword(31); // mov esi, 31: the last row
+						Emitter::Patch(inside, e.code);
+					}
+					e.Byte(0x48); e.Byte(0x85); e.Byte(0x84); e.Byte(0xF3); e.Dword(DISPLAY); // test [display + rsi * 8], rax
+					U8 *clear = e.Jcc(JE);
+					e.Mem(0xC6, 0, VF, false); e.Byte(1); // mov byte [VF], 1
+					Emitter::Patch(clear, e.code);
+					e.Byte(0x48); e.Byte(0x31); e.Byte(0x84); e.Byte(0xF3); e.Dword(DISPLAY); // xor [display + rsi * 8], rax
+					e.Byte(0x41); e.Byte(0x0F); e.Byte(0xAB); e.Byte(0xF3); // bts r11d, esi
+					Emitter::Patch(empty, e.code);
+					if (outside) Emitter::Patch(outside, e.code);
+				};
+				U8 *top = e.code;
+				e.Byte(0x41); e.Byte(0x0F); e.Byte(0xB6); e.Byte(0x10); // movzx edx, byte [r8]
+				e.Byte(0x48); e.Byte(0x89); e.Byte(0xD0); // mov rax, rdx
+				e.Byte(0x48); e.Byte(0xC1); e.Byte(0xE0); e.Byte(56); // shl rax, 56
+				e.Byte(0x44); e.Byte(0x89); e.Byte(0xC9); // mov ecx, r9d
+				e.Byte(0x48); e.Byte(0xD3); e.Byte(0xE8); // shr rax, cl
+				plot(0);
+				e.Byte(0x41); e.Byte(0x83); e.Byte(0xF9); e.Byte(56); // cmp r9d, 56
+				U8 *fits = e.Jcc(JBE);
+				e.Byte(0xB9); e.Dword(120); // mov ecx, 120
+				e.Byte(0x44); e.Byte(0x29); e.Byte(0xC9); // sub ecx, r9d
+				e.Byte(0x48); e.Byte(0x89); e.Byte(0xD0); // mov rax, rdx
+				e.Byte(0x48); e.Byte(0xD3); e.Byte(0xE0); // shl rax, cl
+				plot(1);
+				Emitter::Patch(fits, e.code);
+				e.Byte(0x49); e.Byte(0xFF); e.Byte(0xC0); // inc r8
+				e.Byte(0xFF); e.Byte(0xC7); // inc edi
+				e.Byte(0x4D); e.Byte(0x39); e.Byte(0xD0); // cmp r8, r10
+				Emitter::Patch(e.Jcc(JNE), top);
+				e.Mem(0x09, 11, DIRTY, false); // or [dirtyRows], r11d
+			}
+			e.StoreWord(IDLE, Chip8::NO_IDLE_LOOP);
+			if (chip8.quirks->displayWait) // The frame ends here
+			{
+				e.Mem(0xC6, 0, WAIT, false); e.Byte(1); // mov byte [waitForFrame], 1
+				leave(next);
+				terminated = true;
+			}
+			break;
+		}
+
+		case Chip8::H_LD_K: // Waits on itself while no key is down, Interpret() takes the key
+		{
+			cache.StoreDirty();
+			cache.Forget();
+			e.Byte(0x48); e.Mem(0x8B, RAX, KEYS, false); // mov rax, [keys]
+			e.Byte(0x48); e.Mem(0x0B, RAX, KEYS + 8, false); // or rax, [keys + 8]
+			U8 *pressed = e.Jcc(JNE);
+			e.Mem(0xC6, 0, KEYPRESS, false); e.Byte(0); // mov byte [keyPress], 0
+			loop(pc);
+			Emitter::Patch(pressed, e.code);
+			interpret(pc);
+			break;
+		}
+
+		default:
+			interpret(pc);
+			break;
+		}
+
+		covered[pc] = true;
+		covered[pc + 1] = true;
+		instructions++;
+		pc = next;
+	}
+
+	for (int i = 0; i < instructions; i++)
+	{
+		Exit &exit = exits[i];
+		Emitter::Patch(exit.jump, e.code);
+		e.Byte(0xFF); e.Byte(0xC5); // inc ebp, back to 0
+		memcpy(cache.host, exit.host, sizeof(cache.host));
+		memcpy(cache.dirty, exit.dirty, sizeof(cache.dirty));
+		cache.StoreDirty();
+		leave(exit.pc);
+	}
+
+	entries[address] = start;
+	codeSize = (int)(e.code - codeBuffer);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Chip8.h"
+
+// Translates runs of CHIP-8 instructions (basic blocks) into x86-64 machine code
+// A block ends at the first jump, skip, call or return and goes straight on to the block at its target. V0-VF and I live
+// in host registers inside a block; operations the JIT does not translate (those that write memory, clear the screen or
+// take a random number) run through the interpreter from within the block, and backward jumps call Chip8::SkipIdle()
+// Control only comes back to Chip8::RunJit() when count runs out, the frame ends, compiled code was overwritten or an
+// operation jumped somewhere the block cannot know (BNNN)
+// On other architectures no code is generated and everything runs through the interpreter
+class Chip8Jit
+{
+public:
+	Chip8Jit(Chip8 &chip8);
+	~Chip8Jit();
+
+	int Execute(int count); // Run compiled code from the program counter for at most count instructions, returns the number executed, 0 when it ran none (the interpreter takes over)
+	void Invalidate(U16 address, int count); // Memory was written, drop the compiled code if it covered these addresses
+	void Flush(); // Drop all compiled code
+
+private:
+	typedef int (*EnterFunction)(U8 *reg, int count, const U8 *block); // Returns what is left of count
+
+	void Compile(U16 address);
+	void CompileBlock(U16 address, U16 *pending, int &pendingCount); // Adds the blocks it goes on to that are not compiled yet to pending
+	void SetWritable(bool write); // The code buffer is either writable or executable, never both
+	// Called by the generated code
+	static int Interpret(Chip8Jit *jit, U16 address, int remaining); // For an operation it does not translate, 0 when the code has to stop
+	static int Loop(Chip8Jit *jit, U16 loop, int remaining); // At a backward jump or a wait for a key, returns Chip8::SkipIdle()
+
+	Chip8 &chip8;
+
+	U8 *codeBuffer = nullptr;
+	int codeSize = 0;
+	int fixedSize = 0; // Entry table and stubs at the start of codeBuffer, kept by Flush()
+	U32 flushes = 0; // Tells Interpret() that the operation it ran threw the code away
+	bool writable = true;
+	bool running = false; // Inside the generated code, which cannot be made writable under it
+	bool stale = false; // Invalidated while running, Execute() flushes once the code has returned
+	const U8 **entries = nullptr; // Code of the block at every address, missStub where there is none; in codeBuffer so blocks reach it
+	EnterFunction enter = nullptr;
+	const U8 *exitStub = nullptr; // Restores the registers enter saved and returns what is left of count
+	const U8 *missStub = nullptr; // Sets the program counter to ax, then exitStub
+	bool compiled[4096] = { false };
+	bool covered[4096] = { false }; // Addresses that are part of a compiled block
+	Chip8::Instruction decoded[4096]; // What the blocks pass to Interpret(), decoded when they were compiled
+};
@@ -0,0 +1,158 @@
+#include "Chip8Memo.h"
+
+#include <cstring>
+
+Chip8Memo::Chip8Memo(Chip8 &chip8, Chip8Scheduler &scheduler, size_t capacityBytes) :
+	chip8(chip8), scheduler(scheduler), capacity(capacityBytes)
+{
+}
+
+void Chip8Memo::Clear()
+{
+	entries.clear();
+	index.clear();
+	usedBytes = 0;
+	memset(seen, 0, sizeof(seen));
+}
+
+bool Chip8Memo::RunFrame(int instructions)
+{
+	// The last frame ended in an idle loop, this one most likely skips through it faster than a lookup (Chip8::SkipIdle())
+	if (chip8.GetIdleLoopLength() > 0)
+	{
+		chip8.Run(instructions);
+		return scheduler.TickTimers();
+	}
+
+	// The state hash is already well mixed, the instruction count only has to move it somewhere else
+	U64 key = chip8.GetStateHash() ^ (instructions * 0x9E3779B97F4A7C15ull);
+
+	auto found = index.find(key);
+	if (found != index.end())
+	{
+		Chip8Registers registers;
+		chip8.SaveRegisters(registers);
+		if (memcmp(&registers, &found->second->start, sizeof(Chip8Registers)) == 0)
+		{
+			hits++;
+			entries.splice(entries.begin(), entries, found->second);
+			Apply(*found->second);
+			return found->second->sound;
+		}
+
+		// Another state with the same key: run it, the entry stays for the state it was recorded from
+		misses++;
+		chip8.Run(instructions);
+		return scheduler.TickTimers();
+	}
+
+	misses++;
+	U64 &slot = seen[key % SEEN_SIZE];
+	bool record = slot == key;
+	if (slot != ~key) slot = key; // ~key: the frame ends idle, it is not worth the savestate to record it
+
+	if (record)
+	{
+		chip8.SaveState(before);
+		chip8.SaveRegisters(beforeRegisters);
+	}
+	chip8.Run(instructions);
+	bool sound = scheduler.TickTimers();
+	if (record)
+	{
+		// Frames that end idle are left to the check above
+		if (chip8.GetIdleLoopLength() == 0) Record(key, sound);
+		else slot = ~key;
+	}
+	return sound;
+}
+
+void Chip8Memo::Record(U64 key, bool sound)
+{
+	entries.emplace_front();
+	Entry &entry = entries.front();
+	entry.key = key;
+	entry.sound = sound;
+
+	// Memory in blocks, only the ones that differ are looked at byte by byte
+	const U8 *memory = chip8.GetMemory();
+	const int block = 64;
+	for (int address = 0; address < 4096; address += block)
+	{
+		if (memcmp(&memory[address], &before.memory[address], block) == 0) continue;
+
+		for (int i = address; i < address + block;)
+		{
+			if (memory[i] == before.memory[i])
+			{
+				i++;
+				continue;
+			}
+			int length = 1;
+			while (i + length < address + block && length < 255 && memory[i + length] != before.memory[i + length])
+			{
+				length++;
+			}
+			entry.memory.push_back((U8)(i & 0xFF));
+			entry.memory.push_back((U8)(i >> 8));
+			entry.memory.push_back((U8)length);
+			entry.memory.insert(entry.memory.end(), &memory[i], &memory[i + length]);
+			i += length;
+		}
+	}
+
+	const U64 *display = chip8.GetDisplay();
+	entry.rows = 0;
+	for (int row = 0; row < 32; row++)
+	{
+		if (display[row] != before.display[row])
+		{
+			entry.rows |= 1u << row;
+			entry.rowValues.push_back(display[row]);
+		}
+	}
+
+	entry.start = beforeRegisters;
+	chip8.SaveRegisters(entry.registers);
+
+	index[key] = entries.begin();
+	usedBytes += EntryBytes(entry);
+
+	while (usedBytes > capacity && entries.size() > 1)
+	{
+		const Entry &oldest = entries.back();
+		usedBytes -= EntryBytes(oldest);
+		index.erase(oldest.key);
+		entries.pop_back();
+	}
+}
+
+void Chip8Memo::Apply(const Entry &entry)
+{
+	// What the frame did, through the same calls LoadState() uses
+	const U8 *run = entry.memory.data();
+	const U8 *end = run + entry.memory.size();
+	while (run < end)
+	{
+		U16 address = (U16)(run[0] | run[1] << 8);
+		int length = run[2];
+		chip8.WriteMemory(address, run + 3, length);
+		run += 3 + length;
+	}
+
+	const U64 *rowValue = entry.rowValues.data();
+	for (int row = 0; row < 32; row++)
+	{
+		if ((entry.rows & (1u << row)) == 0) continue;
+
+		chip8.SetDisplayRow(row, *rowValue++);
+	}
+
+	chip8.LoadRegisters(entry.registers);
+}
+
+size_t Chip8Memo::EntryBytes(const Entry &entry)
+{
+	const size_t nodeOverhead = 64; // List node, hash node and bucket
+	return sizeof(Entry) + nodeOverhead + entry.rowValues.capacity() * sizeof(U64) + entry.memory.capacity();
+}
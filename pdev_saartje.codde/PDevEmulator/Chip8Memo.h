@@ -0,0 +1,66 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "Chip8.h"
+#include "Chip8Scheduler.h"
+
+// Frame memoization for long unattended runs
+// A frame at a fixed rate only depends on the machine state (keys included) and its number of instructions, so a frame
+// that starts from a state seen before ends in the same state. The first time a (state hash, instructions) pair comes back
+// the frame is run and its changes recorded; from then on they are applied instead of running it.
+// Attract modes, menus and idle screens turn into one hash, one lookup and a few copies per frame.
+// Entries are kept in least recently used order and the oldest go when the cache is over its capacity
+// A hit is only replayed when the registers, stack, timers and keys are the ones the frame was recorded from; memory
+// and display are only compared through the 64-bit hash, so two states that differ there alone and collide would
+// replay the wrong frame. With n entries that has a chance of about n^2 / 2^65, which is accepted
+class Chip8Memo
+{
+public:
+	Chip8Memo(Chip8 &chip8, Chip8Scheduler &scheduler, size_t capacityBytes = 16 << 20);
+
+	bool RunFrame(int instructions); // chip8.Run(instructions) and scheduler.TickTimers(), returns what TickTimers() returned
+	void Clear();
+
+	long long GetHits() const { return hits; }
+	long long GetMisses() const { return misses; }
+	int GetEntryCount() const { return (int)entries.size(); }
+	size_t GetUsedBytes() const { return usedBytes; }
+
+private:
+	struct Entry
+	{
+		U64 key;
+		bool sound;
+		Chip8Registers start; // Registers the frame was recorded from
+		Chip8Registers registers; // After the frame, always stored whole
+		U32 rows; // Display rows the frame changed, their new values in rowValues
+		std::vector<U64> rowValues;
+		std::vector<U8> memory; // Runs of bytes the frame wrote: U16 address, U8 length, the bytes
+	};
+
+	void Record(U64 key, bool sound);
+	void Apply(const Entry &entry);
+	static size_t EntryBytes(const Entry &entry); // Including the list and map nodes, roughly
+
+	Chip8 &chip8;
+	Chip8Scheduler &scheduler;
+	size_t capacity;
+	size_t usedBytes = 0;
+
+	std::list<Entry> entries; // Most recently used first
+	std::unordered_map<U64, std::list<Entry>::iterator> index;
+
+	// Keys of frames run once, a frame is only recorded when it comes back; most frames of a game never do
+	// A frame that ended in an idle loop the second time is marked with ~key and never recorded
+	static const int SEEN_SIZE = 4096;
+	U64 seen[SEEN_SIZE] = { 0 };
+
+	Chip8State before; // State at the start of the frame being recorded
+	Chip8Registers beforeRegisters;
+
+	long long hits = 0;
+	long long misses = 0;
+};
@@ -0,0 +1,377 @@
+// Semantics of every CHIP-8 operation, shared by all execution cores in Chip8.cpp
+// The including core defines OPERATION(handler) and END_OPERATION around each body,
+// and provides `instruction` (const Instruction *) together with the operands `x` and `y`,
+// and `remaining`, the number of instructions left in the batch after this one
+// Q is the Quirks profile the core is instantiated for
+
+OPERATION(H_SCHIP)
+	switch (instruction->nn)
+	{
+	case 0xC0: std::cout << "SCHIP-8 /case 0x00CN" << std::endl; break; // Scroll display N lines down
+	case 0xFB: std::cout << "SCHIP-8 /case 0x00FB" << std::endl; break; // Scroll display 4 pixels RIGHT
+	case 0xFC: std::cout << "SCHIP-8 /case 0x00FC" << std::endl; break; // Scroll display 4 pixels LEFT
+	case 0xFD: std::cout << "SCHIP-8 /case 0x00FD" << std::endl; break; // Exit CHIP interpreter
+	case 0xFE: std::cout << "SCHIP-8 /case 0x00FE" << std::endl; break; // Disable extended screen mode
+	case 0xFF: std::cout << "SCHIP-8 /case 0x00FF" << std::endl; break; // Enable extended screen mode for full-screen graphics
+	case 0x30: std::cout << "SCHIP-8 /case 0x0030" << std::endl; break; // Point to I to 10-byte font sprite for digit VX (0..9)
+	case 0x75: std::cout << "SCHIP-8 /case 0x075" << std::endl; break; // STORE V0..VX in RPL user flags (x <= 7)
+	case 0x85: std::cout << "SCHIP-8 /case 0x085" << std::endl; break; // READ V0..VX in RPL user flags (x <= 7)
+	}
+END_OPERATION
+
+OPERATION(H_CLS)
+	// Clear the screen
+	for (int i = 0; i < 32; i++)
+	{
+		display[i] = 0;
+	}
+	dirtyRows = 0xFFFFFFFF;
+	idleLoop = NO_IDLE_LOOP;
+END_OPERATION
+
+OPERATION(H_RET)
+	// Return from a subroutine
+	stackPointer = (stackPointer - 1) & 0xF; // remove the top stack, an empty stack wraps around instead of reading past it
+	regPC = stack[stackPointer]; // set regPC to the previous stack
+END_OPERATION
+
+OPERATION(H_JP)
+	// Jump to address NNN
+	if (instruction->nnn < regPC)
+	{
+		remaining = SkipIdle(instruction->nnn, remaining); // Backward jump, maybe an idle loop
+	}
+	regPC = instruction->nnn;
+END_OPERATION
+
+OPERATION(H_CALL)
+	// Execute subroutine starting at address NNN
+	stack[stackPointer & 0xF] = regPC; // A 17th call wraps around instead of writing past the stack
+	stackPointer = (stackPointer & 0xF) + 1;
+	regPC = instruction->nnn;
+END_OPERATION
+
+OPERATION(H_SE_NN)
+	// Skip the following instruction if the value of register VX equals NN
+	if (reg[x] == instruction->nn)
+	{
+		regPC += 2;
+	}
+END_OPERATION
+
+OPERATION(H_SNE_NN)
+	// Skip the following instruction if the value of register VX is not equal to NN
+	if (reg[x] != instruction->nn)
+	{
+		regPC += 2;
+	}
+END_OPERATION
+
+OPERATION(H_SE_XY)
+	// Skip the following instruction if the value of register VX is equal to the value of register VY
+	if (reg[x] == reg[y])
+	{
+		regPC += 2;
+	}
+END_OPERATION
+
+OPERATION(H_LD_NN)
+	// Store number NN in register VX
+	reg[x] = instruction->nn;
+END_OPERATION
+
+OPERATION(H_ADD_NN)
+	// Add the value NN to register VX
+	reg[x] += instruction->nn;
+END_OPERATION
+
+OPERATION(H_LD_XY)
+	// Store the value of register VY in register VX
+	reg[x] = reg[y];
+END_OPERATION
+
+OPERATION(H_OR)
+	// Set VX to VX OR VY
+	reg[x] |= reg[y];
+	if (Q::resetVF)
+	{
+		reg[0xF] = 0;
+	}
+END_OPERATION
+
+OPERATION(H_AND)
+	// Set VX to VX AND VY
+	reg[x] &= reg[y];
+	if (Q::resetVF)
+	{
+		reg[0xF] = 0;
+	}
+END_OPERATION
+
+OPERATION(H_XOR)
+	// Set VX to VX XOR VY
+	reg[x] ^= reg[y];
+	if (Q::resetVF)
+	{
+		reg[0xF] = 0;
+	}
+END_OPERATION
+
+OPERATION(H_ADD_XY)
+	// Add the value of register VY to register VX
+	// Set VF to 1 if a carry occurs
+	// Set VF to 0 if a carry does not occur
+	if ((reg[x] + reg[y]) > 255)
+	{
+		reg[0x000F] = 1;
+	}
+	else
+	{
+		reg[0x000F] = 0;
+	}
+	reg[x] += reg[y];
+END_OPERATION
+
+OPERATION(H_SUB)
+	// Subtract the value of register VY from register VX
+	// Set VF to 0 if a borrow occurs
+	// Set VF to 1 if a borrow does not occur
+	if (reg[y] > reg[x])
+	{
+		reg[0xF] = 0;
+	}
+	else
+	{
+		reg[0xF] = 1;
+	}
+	reg[x] -= reg[y];
+END_OPERATION
+
+OPERATION(H_SHR)
+	// Store the value of register VY shifted right one bit in register VX
+	// Set register VF to the least significant bit prior to the shift
+	if (Q::shiftVY)
+	{
+		reg[0xF] = reg[y] & 0x1;
+		reg[x] = reg[y] >> 1;
+	}
+	else
+	{
+		reg[0xF] = reg[x] & 0x1;
+		reg[x] >>= 1;
+	}
+END_OPERATION
+
+OPERATION(H_SUBN)
+	// Set register VX to the value of VY minus VX
+	// Set VF to 0 if a borrow occurs
+	// Set VF to 1 if a borrow does not occur
+	if (reg[y] < reg[x])
+	{
+		reg[0xF] = 0;
+	}
+	else
+	{
+		reg[0xF] = 1;
+	}
+	reg[x] = reg[y] - reg[x];
+END_OPERATION
+
+OPERATION(H_SHL)
+	// Store the value of register VY shifted left one bit in register VX
+	// Set register VF to the most significant bit prior to the shift
+	if (Q::shiftVY)
+	{
+		reg[0xF] = reg[y] >> 7;
+		reg[x] = reg[y] << 1;
+	}
+	else
+	{
+		reg[0xF] = reg[x] >> 7;
+		reg[x] <<= 1;
+	}
+END_OPERATION
+
+OPERATION(H_SNE_XY)
+	// Skip the following instruction if the value of register VX is not equal to the value of register VY
+	if (reg[x] != reg[y])
+	{
+		regPC += 2;
+	}
+END_OPERATION
+
+OPERATION(H_LD_I)
+	// Store memory address NNN in register I
+	regI = instruction->nnn;
+END_OPERATION
+
+OPERATION(H_JP_V0)
+	// Jump to address NNN + V0 (or XNN + VX)
+	regPC = instruction->nnn + reg[Q::jumpVX ? x : 0];
+END_OPERATION
+
+OPERATION(H_RND)
+	// Set VX to a random number with a mask of NN
+	randomState = randomState * 214013 + 2531011;
+	reg[x] = (((randomState >> 16) & 0x7FFF) % 255) & instruction->nn;
+	idleLoop = NO_IDLE_LOOP;
+END_OPERATION
+
+OPERATION(H_DRW)
+	// Draw
+	// A sprite row is placed in the display rows with a shift, collisions are an AND and drawing an XOR
+	// Pixels are addressed like in a 64 * 32 array: what runs past the right edge continues at the start of the next row
+	U16 X = reg[x];
+	U16 Y = reg[y];
+	U16 height = instruction->n;
+	int column = X & 63;
+
+	reg[0xF] = 0; // reset register
+	for (int yPos = 0; yPos < height; ++yPos) // loop over each row
+	{
+		U64 pixel = memoryBuffer[regI + yPos]; // fetch pixel value from memory starting at position regI
+		U64 pixels[2] =
+		{
+			pixel << 56 >> column, // Part of the sprite row that fits in the display row
+			column > 56 ? pixel << (120 - column) : 0 // Part that continues in the next display row
+		};
+		for (int part = 0; part < 2; ++part)
+		{
+			if (pixels[part] == 0)
+			{
+				continue;
+			}
+			int row = Y + yPos + (X >> 6) + part;
+			// For fixing problem n2: 0xDXYN can either ignore pixels that fall outside the screen, or wrap around
+			if (row > 31)
+			{
+				if (Q::ignorePixel)
+				{
+					continue;
+				}
+				row = 31; // -> Wraps to the last row
+			}
+
+			if ((display[row] & pixels[part]) != 0) // check if any of the pixels on display is set,
+			{
+				reg[0xF] = 1; // if it is, register collision by setting register
+			}
+			display[row] ^= pixels[part]; // set pixel values, using xor
+			dirtyRows |= 1u << row;
+		}
+	}
+	idleLoop = NO_IDLE_LOOP;
+	if (Q::displayWait)
+	{
+		waitForFrame = true;
+	}
+END_OPERATION
+
+OPERATION(H_SKP)
+	// Skip the following instruction if the key currently stored in register VX is pressed
+	if (keys[reg[x]] != 0)
+	{
+		regPC += 2;
+	}
+END_OPERATION
+
+OPERATION(H_SKNP)
+	// Skip the following instruction if the key currently stored in register VX is not pressed
+	if (keys[reg[x]] == 0)
+	{
+		regPC += 2;
+	}
+END_OPERATION
+
+OPERATION(H_LD_VX_DT)
+	// Store the current value of the delay timer in register VX
+	reg[x] = delayTimer;
+END_OPERATION
+
+OPERATION(H_LD_K)
+	// Wait for a keypress and store the result in register VX
+	keyPress = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if (keys[i] != 0)
+		{
+			reg[x] = i;
+			keys[i] = 0;
+			keyPress = 1;
+		}
+	}
+	if (!keyPress)
+	{
+		regPC -= 2; // When there's no keypress received, return  
+		remaining = SkipIdle(regPC, remaining); // Nothing else to do in this batch
+	}
+	else
+	{
+		idleLoop = NO_IDLE_LOOP;
+	}
+END_OPERATION
+
+OPERATION(H_LD_DT)
+	// Set the delay timer to the value of register VX
+	delayTimer = reg[x];
+END_OPERATION
+
+OPERATION(H_LD_ST)
+	// Set the sound timer to the value of register VX
+	soundTimer = reg[x];
+END_OPERATION
+
+OPERATION(H_ADD_I)
+	// Add the value stored in register VX to register I
+	if (regI + reg[x] > 0xFFF) // for the carry
+	{
+		reg[0xF] = 1; // ex. 5 + 5, 2 digits, reg[0xF] = 1
+	}
+	else
+	{
+		reg[0xF] = 0;
+	}
+	regI += reg[x];
+END_OPERATION
+
+OPERATION(H_LD_F)
+	// Set I to the memory address of the sprite data corresponding to the hexadecimal digit stored in register VX
+	regI = reg[x] * 5;
+END_OPERATION
+
+OPERATION(H_LD_B)
+	// Store the binary-coded decimal equivalent of the value stored in register VX at addresses I, I + 1, and I + 2
+	memoryBuffer[regI] = reg[x] / 100;
+	memoryBuffer[regI + 1] = (reg[x] / 10) % 10;
+	memoryBuffer[regI + 2] = (reg[x] % 100) % 10;
+	InvalidateDecoded(regI, 3);
+END_OPERATION
+
+OPERATION(H_LD_MEM_VX)
+	// Store the values of registers V0 to VX inclusive in memory starting at address I
+	// I is set to I + X + 1 after operation
+	for (int i = 0; i <= x; i++)
+	{
+		memoryBuffer[regI + i] = reg[i];
+	}
+	InvalidateDecoded(regI, x + 1);
+	// For fixing problem n1: 0xFX55 and 0xFX65 can either not modify register I, or increment it by X + 1
+	if (Q::incrementRegI)
+	{
+		regI += x + 1;
+	}
+END_OPERATION
+
+OPERATION(H_LD_VX_MEM)
+	// Fill registers V0 to VX inclusive with the values stored in memory starting at address I
+	// I is set to I + X + 1 after operation
+	for (int i = 0; i <= x; i++)
+	{
+		reg[i] = memoryBuffer[regI + i];
+	}
+	// For fixing problem n1: 0xFX55 and 0xFX65 can either not modify register I, or increment it by X + 1
+	if (Q::incrementRegI)
+	{
+		regI += x + 1;
+	}
+END_OPERATION
@@ -0,0 +1,214 @@
+#include "Chip8PerfCounters.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <ctime>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char *names[Chip8PerfCounters::COUNTER_COUNT] =
+	{
+		"cycles", "instructions", "branch-misses", "l1d-misses", "task-clock-ns", "context-switches", "page-faults"
+	};
+
+#if defined(__linux__)
+	struct EventType
+	{
+		unsigned int type;
+		unsigned long long config;
+	};
+	const EventType events[Chip8PerfCounters::COUNTER_COUNT] =
+	{
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+	};
+
+	// Value, time enabled and time running, the last two tell how long the kernel multiplexed the counter out
+	struct Reading
+	{
+		unsigned long long value;
+		unsigned long long enabled;
+		unsigned long long running;
+	};
+#endif
+}
+
+const char *Chip8PerfCounters::Name(Counter counter)
+{
+	return names[counter];
+}
+
+Chip8PerfCounters::Chip8PerfCounters()
+{
+	for (int &descriptor : descriptors)
+	{
+		descriptor = -1;
+	}
+}
+
+Chip8PerfCounters::~Chip8PerfCounters()
+{
+#if defined(__linux__)
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0) close(descriptor);
+	}
+#endif
+}
+
+bool Chip8PerfCounters::Open()
+{
+#if defined(__linux__)
+	bool any = false;
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = events[i].type;
+		attributes.config = events[i].config;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1; // Allowed with perf_event_paranoid up to 2
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		descriptors[i] = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0); // This thread, any CPU
+		available[i] = descriptors[i] >= 0;
+		any |= available[i];
+	}
+	if (any) return true;
+
+	// perf_event_open is not allowed at all (seccomp), count what getrusage and the thread CPU clock know
+	fromRusage = true;
+	available[TASK_CLOCK] = available[CONTEXT_SWITCHES] = available[PAGE_FAULTS] = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Chip8PerfCounters::HasHardwareCounters() const
+{
+	return available[CYCLES] || available[INSTRUCTIONS] || available[BRANCH_MISSES] || available[L1D_MISSES];
+}
+
+const char *Chip8PerfCounters::GetSource() const
+{
+	if (fromRusage) return "getrusage";
+	if (HasHardwareCounters()) return "perf_event";
+	return available[TASK_CLOCK] ? "perf_event software" : "none";
+}
+
+void Chip8PerfCounters::Start()
+{
+#if defined(__linux__)
+	if (fromRusage)
+	{
+		ReadRusage(rusageStart);
+	}
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0) ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+	running = true;
+}
+
+void Chip8PerfCounters::Stop()
+{
+#if defined(__linux__)
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0) ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+	}
+	if (fromRusage && running)
+	{
+		long long now[COUNTER_COUNT];
+		ReadRusage(now);
+		for (int i = 0; i < COUNTER_COUNT; i++)
+		{
+			rusageTotal[i] += now[i] - rusageStart[i];
+		}
+	}
+#endif
+	running = false;
+}
+
+void Chip8PerfCounters::Reset()
+{
+#if defined(__linux__)
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0) ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+	}
+	if (fromRusage && running)
+	{
+		ReadRusage(rusageStart);
+	}
+#endif
+	for (long long &total : rusageTotal)
+	{
+		total = 0;
+	}
+}
+
+long long Chip8PerfCounters::Get(Counter counter) const
+{
+#if defined(__linux__)
+	if (fromRusage)
+	{
+		if (!running) return rusageTotal[counter];
+
+		long long now[COUNTER_COUNT];
+		ReadRusage(now);
+		return rusageTotal[counter] + now[counter] - rusageStart[counter];
+	}
+
+	Reading reading;
+	if (descriptors[counter] < 0 || read(descriptors[counter], &reading, sizeof(reading)) != (ssize_t)sizeof(reading))
+	{
+		return 0;
+	}
+	if (reading.running == 0) return 0;
+	if (reading.running < reading.enabled)
+	{
+		return (long long)((double)reading.value * reading.enabled / reading.running);
+	}
+	return (long long)reading.value;
+#else
+	(void)counter;
+	return 0;
+#endif
+}
+
+void Chip8PerfCounters::ReadRusage(long long values[COUNTER_COUNT]) const
+{
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		values[i] = 0;
+	}
+#if defined(__linux__)
+	timespec cpu;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu) == 0)
+	{
+		values[TASK_CLOCK] = cpu.tv_sec * 1000000000LL + cpu.tv_nsec;
+	}
+	rusage usage;
+	if (getrusage(RUSAGE_THREAD, &usage) == 0)
+	{
+		values[CONTEXT_SWITCHES] = usage.ru_nvcsw + usage.ru_nivcsw;
+		values[PAGE_FAULTS] = usage.ru_minflt + usage.ru_majflt;
+	}
+#endif
+}
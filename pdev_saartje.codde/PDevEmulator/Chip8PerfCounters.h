@@ -0,0 +1,48 @@
+#pragma once
+
+// Performance counters of the calling thread around a piece of code, for the benchmark and the headless runner
+// On Linux the hardware counters come from perf_event_open. Where the PMU cannot be used (containers, virtual machines,
+// perf_event_paranoid) only the software counters are there, and where perf_event_open itself is not allowed they are
+// taken from getrusage and the thread CPU clock. Elsewhere Open() fails
+class Chip8PerfCounters
+{
+public:
+	enum Counter
+	{
+		CYCLES,
+		INSTRUCTIONS, // Host instructions
+		BRANCH_MISSES,
+		L1D_MISSES, // Level 1 data cache read misses
+		TASK_CLOCK, // CPU time in nanoseconds
+		CONTEXT_SWITCHES,
+		PAGE_FAULTS,
+		COUNTER_COUNT
+	};
+	static const char *Name(Counter counter); // Short name for reports, e.g. "branch-misses"
+
+	Chip8PerfCounters();
+	~Chip8PerfCounters();
+	Chip8PerfCounters(const Chip8PerfCounters &) = delete;
+	Chip8PerfCounters &operator=(const Chip8PerfCounters &) = delete;
+
+	bool Open(); // Returns whether any counter is available
+	bool IsAvailable(Counter counter) const { return available[counter]; }
+	bool HasHardwareCounters() const; // Cycles, instructions, branch and cache misses are counted
+	const char *GetSource() const; // "perf_event", "perf_event software", "getrusage" or "none", for reports
+
+	// Counting only happens between Start() and Stop(), the counts of several intervals add up
+	void Start();
+	void Stop();
+	void Reset();
+	long long Get(Counter counter) const; // Scaled up when the kernel multiplexed the counter, 0 when it is not available
+
+private:
+	bool available[COUNTER_COUNT] = {};
+	int descriptors[COUNTER_COUNT]; // perf_event_open file descriptors, -1 for counters taken from getrusage
+	bool fromRusage = false;
+	bool running = false;
+	long long rusageTotal[COUNTER_COUNT] = {}; // Counted in the previous intervals
+	long long rusageStart[COUNTER_COUNT] = {};
+
+	void ReadRusage(long long values[COUNTER_COUNT]) const;
+};
@@ -0,0 +1,192 @@
+#include "Chip8Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	const char *classNames[Chip8Profiler::CLASS_COUNT] =
+	{
+		"0NNN", "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+		"8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+		"9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+		"FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65", "????"
+	};
+	const int UNKNOWN = Chip8Profiler::CLASS_COUNT - 1;
+
+	// Index in classNames of the FX opcodes
+	int FClass(U16 opcode)
+	{
+		switch (opcode & 0x00FF)
+		{
+		case 0x07: return 26;
+		case 0x0A: return 27;
+		case 0x15: return 28;
+		case 0x18: return 29;
+		case 0x1E: return 30;
+		case 0x29: return 31;
+		case 0x33: return 32;
+		case 0x55: return 33;
+		case 0x65: return 34;
+		}
+		return UNKNOWN;
+	}
+}
+
+int Chip8Profiler::OpcodeClass(U16 opcode)
+{
+	switch (opcode >> 12)
+	{
+	case 0x0:
+		if (opcode == 0x00E0) return 1;
+		if (opcode == 0x00EE) return 2;
+		return 0;
+	case 0x8:
+		switch (opcode & 0x000F)
+		{
+		case 0x0: case 0x1: case 0x2: case 0x3: case 0x4: case 0x5: case 0x6: case 0x7: return 10 + (opcode & 0x000F);
+		case 0xE: return 18;
+		}
+		return UNKNOWN;
+	case 0xE:
+		if ((opcode & 0x00FF) == 0x9E) return 24;
+		if ((opcode & 0x00FF) == 0xA1) return 25;
+		return UNKNOWN;
+	case 0xF:
+		return FClass(opcode);
+	case 0x9: return 19;
+	case 0xA: return 20;
+	case 0xB: return 21;
+	case 0xC: return 22;
+	case 0xD: return 23;
+	default: return 2 + (opcode >> 12); // 1NNN to 7XNN
+	}
+}
+
+const char *Chip8Profiler::ClassName(int opcodeClass)
+{
+	return classNames[opcodeClass];
+}
+
+Chip8Profiler::Chip8Profiler()
+{
+	Reset();
+}
+
+void Chip8Profiler::Reset()
+{
+	nodes.assign(1, Node{ 0, 0x200 });
+	children.clear();
+	current = 0;
+	total = Counter();
+	for (Counter &counter : classes) counter = Counter();
+	for (Counter &counter : addresses) counter = Counter();
+	memset(opcodes, 0, sizeof(opcodes));
+	stacks.clear();
+}
+
+void Chip8Profiler::Record(U16 address, U16 opcode, long long nanoseconds)
+{
+	address &= 0x0FFF;
+	int opcodeClass = OpcodeClass(opcode);
+
+	total.executions++;
+	total.nanoseconds += nanoseconds;
+	classes[opcodeClass].executions++;
+	classes[opcodeClass].nanoseconds += nanoseconds;
+	addresses[address].executions++;
+	addresses[address].nanoseconds += nanoseconds;
+	opcodes[address] = opcode;
+
+	Counter &stack = stacks[((unsigned int)current << 12) | address];
+	stack.executions++;
+	stack.nanoseconds += nanoseconds;
+
+	// Follow the program into and out of subroutines, the instruction itself is counted in the caller
+	if (opcodeClass == 4) // 2NNN
+	{
+		std::pair<int, U16> key(current, opcode & 0x0FFF);
+		auto found = children.find(key);
+		if (found == children.end())
+		{
+			found = children.insert(std::make_pair(key, (int)nodes.size())).first;
+			nodes.push_back(Node{ current, (U16)(opcode & 0x0FFF) });
+		}
+		current = found->second;
+	}
+	else if (opcodeClass == 2 && current != 0) // 00EE, a return without call (profiler attached in a subroutine) stays at the root
+	{
+		current = nodes[current].parent;
+	}
+}
+
+void Chip8Profiler::WriteFolded(FILE *out, bool byTime) const
+{
+	// Sorted, so that the output does not depend on the hash map
+	std::vector<std::pair<unsigned int, Counter>> sorted(stacks.begin(), stacks.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<unsigned int, Counter> &a, const std::pair<unsigned int, Counter> &b) { return a.first < b.first; });
+
+	char frame[32];
+	for (const auto &entry : sorted)
+	{
+		long long weight = byTime ? entry.second.nanoseconds : entry.second.executions;
+		if (weight == 0) continue;
+
+		int node = entry.first >> 12;
+		U16 address = entry.first & 0x0FFF;
+
+		std::string line;
+		for (; node != 0; node = nodes[node].parent)
+		{
+			snprintf(frame, sizeof(frame), ";sub_%04X", nodes[node].address);
+			line.insert(0, frame);
+		}
+		snprintf(frame, sizeof(frame), ";%04X_%s", address, ClassName(OpcodeClass(opcodes[address])));
+		fprintf(out, "main%s%s %lld\n", line.c_str(), frame, weight);
+	}
+}
+
+void Chip8Profiler::WriteHotSpots(FILE *out) const
+{
+	std::vector<int> order;
+	for (int address = 0; address < 4096; address++)
+	{
+		if (addresses[address].executions > 0) order.push_back(address);
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b)
+	{
+		return addresses[a].nanoseconds != addresses[b].nanoseconds ? addresses[a].nanoseconds > addresses[b].nanoseconds : a < b;
+	});
+
+	fprintf(out, "address,opcode,class,executions,nanoseconds,ns_per_execution,time_share\n");
+	for (int address : order)
+	{
+		const Counter &counter = addresses[address];
+		fprintf(out, "%04X,%04X,%s,%lld,%lld,%.2f,%.6f\n", address, opcodes[address], ClassName(OpcodeClass(opcodes[address])),
+			counter.executions, counter.nanoseconds, (double)counter.nanoseconds / counter.executions,
+			total.nanoseconds > 0 ? (double)counter.nanoseconds / total.nanoseconds : 0.0);
+	}
+}
+
+void Chip8Profiler::WriteOpcodes(FILE *out) const
+{
+	std::vector<int> order;
+	for (int opcodeClass = 0; opcodeClass < CLASS_COUNT; opcodeClass++)
+	{
+		if (classes[opcodeClass].executions > 0) order.push_back(opcodeClass);
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b)
+	{
+		return classes[a].nanoseconds != classes[b].nanoseconds ? classes[a].nanoseconds > classes[b].nanoseconds : a < b;
+	});
+
+	fprintf(out, "class,executions,nanoseconds,ns_per_execution,execution_share,time_share\n");
+	for (int opcodeClass : order)
+	{
+		const Counter &counter = classes[opcodeClass];
+		fprintf(out, "%s,%lld,%lld,%.2f,%.6f,%.6f\n", ClassName(opcodeClass), counter.executions, counter.nanoseconds,
+			(double)counter.nanoseconds / counter.executions, (double)counter.executions / total.executions,
+			total.nanoseconds > 0 ? (double)counter.nanoseconds / total.nanoseconds : 0.0);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Chip8.h"
+
+// Counts executions and host time per opcode class and per address, and per call stack implied by 2NNN/00EE
+// Chip8 only feeds it when compiled with CHIP8_PROFILE and a profiler is attached with SetProfiler(); without
+// CHIP8_PROFILE the hooks are not there at all. While attached every core runs through the switch core,
+// one instruction at a time, so the numbers show where the interpreter spends its time, not the JIT or generated code
+class Chip8Profiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// Opcode classes, named after the instruction pattern (00E0, DXYN, 8XY4, FX65, ...)
+	static const int CLASS_COUNT = 36;
+	static int OpcodeClass(U16 opcode);
+	static const char *ClassName(int opcodeClass);
+
+	Chip8Profiler();
+
+	void Reset();
+	void Record(U16 address, U16 opcode, long long nanoseconds); // One executed instruction
+
+	// Folded stacks for flamegraph.pl and compatible tools, one line per call stack and instruction address:
+	// main;sub_0234;sub_02A0;02A6_DXYN 12345
+	// The weight is host nanoseconds, or executions when byTime is false
+	void WriteFolded(FILE *out, bool byTime = true) const;
+	void WriteHotSpots(FILE *out) const; // CSV per address, the most expensive first
+	void WriteOpcodes(FILE *out) const; // CSV per opcode class, the most expensive first
+
+	struct Counter
+	{
+		long long executions = 0;
+		long long nanoseconds = 0;
+	};
+	const Counter &GetClass(int opcodeClass) const { return classes[opcodeClass]; }
+	const Counter &GetAddress(U16 address) const { return addresses[address & 0x0FFF]; }
+	long long GetTotalNanoseconds() const { return total.nanoseconds; }
+	long long GetTotalExecutions() const { return total.executions; }
+
+private:
+	// Call stacks as a tree, node 0 is the root; a node is the subroutine entered from its parent
+	struct Node
+	{
+		int parent;
+		U16 address;
+	};
+	std::vector<Node> nodes;
+	std::map<std::pair<int, U16>, int> children; // (parent, subroutine address) -> node
+	int current = 0; // Node of the subroutine the program is in
+
+	Counter total;
+	Counter classes[CLASS_COUNT];
+	Counter addresses[4096];
+	U16 opcodes[4096]; // Last opcode executed at each address
+	std::unordered_map<unsigned int, Counter> stacks; // (node << 12) | address -> counter
+};
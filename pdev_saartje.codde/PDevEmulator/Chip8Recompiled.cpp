@@ -0,0 +1,60 @@
+#include "Chip8Recompiled.h"
+
+RecompiledProgram *Chip8Recompiled::programs = nullptr;
+
+RecompiledRegistration::RecompiledRegistration(RecompiledProgram &program)
+{
+	program.next = Chip8Recompiled::programs;
+	Chip8Recompiled::programs = &program;
+}
+
+const RecompiledProgram *Chip8Recompiled::Find(const U8 *rom, int size)
+{
+	unsigned int hash = Hash(rom, size);
+
+	for (const RecompiledProgram *program = programs; program != nullptr; program = program->next)
+	{
+		if (program->romSize == size && program->romHash == hash)
+		{
+			return program;
+		}
+	}
+	return nullptr;
+}
+
+unsigned int Chip8Recompiled::Hash(const U8 *data, int size)
+{
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+RecompiledState Chip8Recompiled::Bind(Chip8 &chip8)
+{
+	RecompiledState state;
+	state.chip8 = &chip8;
+	state.reg = chip8.reg;
+	state.stack = chip8.stack;
+	state.stackPointer = &chip8.stackPointer;
+	state.regI = &chip8.regI;
+	state.regPC = &chip8.regPC;
+	state.delayTimer = &chip8.delayTimer;
+	state.soundTimer = &chip8.soundTimer;
+	return state;
+}
+
+bool Chip8Recompiled::Step(RecompiledState &state)
+{
+	state.chip8->Tick();
+	return state.chip8->recompiled != nullptr;
+}
+
+int Chip8Recompiled::Loop(RecompiledState &state, int remaining)
+{
+	return state.chip8->SkipIdle(*state.regPC, remaining);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Chip8.h"
+
+// Interface between Chip8 and the C++ files generated ahead of time by Chip8Recompiler
+// A generated file defines one RecompiledProgram for one ROM and registers it with a RecompiledRegistration
+// Add the generated file to the project, CORE_STATIC then runs it whenever that exact ROM is loaded
+
+// Machine state as seen by the generated code
+struct RecompiledState
+{
+	Chip8 *chip8;
+	U8 *reg;
+	U16 *stack;
+	U16 *stackPointer;
+	U16 *regI;
+	U16 *regPC;
+	U8 *delayTimer;
+	U8 *soundTimer;
+};
+
+// Runs the code at *state.regPC for at most count instructions, returns the number of instructions executed
+// Returns 0 when the program counter is not the start of a recompiled block or the block does not fit in count
+typedef int (*RecompiledFunction)(RecompiledState &state, int count);
+
+struct RecompiledProgram
+{
+	const char *name;
+	unsigned int romHash; // Chip8Recompiled::Hash() of the ROM the code was generated from
+	int romSize;
+	const U32 *code; // 4096 bits, one per byte of memory the generated code was translated from; writes to them disable the program
+	RecompiledFunction run;
+	RecompiledProgram *next;
+};
+
+struct RecompiledRegistration
+{
+	RecompiledRegistration(RecompiledProgram &program);
+};
+
+class Chip8Recompiled
+{
+public:
+	static const RecompiledProgram *Find(const U8 *rom, int size);
+	static unsigned int Hash(const U8 *data, int size);
+
+	static RecompiledState Bind(Chip8 &chip8);
+	// Interpret the instruction at *state.regPC; false when it wrote into the translated code and disabled the program,
+	// the generated code then has to return without running any more of itself
+	static bool Step(RecompiledState &state);
+	// After a backward jump to *state.regPC with remaining instructions left in the batch: what is left once the whole
+	// iterations of an idle loop are skipped (Chip8::SkipIdle()), the generated code counts the skipped ones as executed
+	static int Loop(RecompiledState &state, int remaining);
+
+private:
+	friend struct RecompiledRegistration;
+	static RecompiledProgram *programs;
+};
@@ -0,0 +1,256 @@
+#include "Chip8Rewind.h"
+
+#include <cstring>
+
+Chip8Rewind::Chip8Rewind(size_t capacityBytes, int keyframeInterval) :
+	capacity((U32)(capacityBytes < MAX_CAPACITY ? capacityBytes : MAX_CAPACITY)), keyframeInterval(keyframeInterval)
+{
+	buffer.reset(new U8[capacity]);
+}
+
+void Chip8Rewind::Clear()
+{
+	entries.clear();
+	head = 0;
+	sinceKeyframe = 0;
+	forceKeyframe = true;
+	source = nullptr;
+}
+
+size_t Chip8Rewind::GetUsedBytes() const
+{
+	size_t bytes = entries.size() * sizeof(Entry);
+	for (const Entry &entry : entries)
+	{
+		bytes += entry.size;
+	}
+	return bytes;
+}
+
+namespace
+{
+	const int blockSize = 64; // Bytes compared at once to skip the unchanged parts quickly
+	const int maxGap = 2; // Zero bytes a literal run carries rather than ending, a new run costs at least 2 bytes
+	const U8 zeros[blockSize] = {};
+
+	U8 *WriteCount(U8 *out, int count)
+	{
+		// 7 bits per byte, the high bit tells that another byte follows
+		while (count >= 0x80)
+		{
+			*out++ = (U8)(count | 0x80);
+			count >>= 7;
+		}
+		*out++ = (U8)count;
+		return out;
+	}
+
+	const U8 *ReadCount(const U8 *in, int &count)
+	{
+		count = 0;
+		for (int shift = 0;; shift += 7)
+		{
+			U8 byte = *in++;
+			count |= (byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) return in;
+		}
+	}
+}
+
+int Chip8Rewind::Encode(const Chip8State &state, const Chip8State *reference, U32 memoryChunks, U8 *out)
+{
+	const U8 *bytes = (const U8 *)&state;
+	const U8 *referenceBytes = (const U8 *)reference;
+	U8 *start = out;
+
+	int written = 0; // State bytes covered by the runs written so far
+	int literalStart = -1; // Run being collected
+	int literalEnd = -1;
+
+	for (int block = 0; block < (int)sizeof(Chip8State); block += blockSize)
+	{
+		if (block < (int)sizeof(state.memory) && (memoryChunks & (1u << (block >> 8))) == 0) continue;
+
+		int size = (int)sizeof(Chip8State) - block < blockSize ? (int)sizeof(Chip8State) - block : blockSize;
+		if (memcmp(bytes + block, referenceBytes ? referenceBytes + block : zeros, size) == 0) continue;
+
+		for (int word = block; word < block + size; word += 8)
+		{
+			U64 value, base = 0;
+			memcpy(&value, bytes + word, 8);
+			if (referenceBytes) memcpy(&base, referenceBytes + word, 8);
+			if (value == base) continue;
+
+			for (int i = word; i < word + 8; i++)
+			{
+				if (bytes[i] == (referenceBytes ? referenceBytes[i] : 0)) continue;
+
+				if (literalStart >= 0 && i - literalEnd <= maxGap)
+				{
+					literalEnd = i + 1;
+					continue;
+				}
+				if (literalStart >= 0)
+				{
+					// A run: the count of unchanged bytes, the count of changed bytes and the changed bytes XOR the reference
+					out = WriteCount(out, literalStart - written);
+					out = WriteCount(out, literalEnd - literalStart);
+					for (int j = literalStart; j < literalEnd; j++)
+					{
+						*out++ = bytes[j] ^ (referenceBytes ? referenceBytes[j] : 0);
+					}
+					written = literalEnd;
+				}
+				literalStart = i;
+				literalEnd = i + 1;
+			}
+		}
+	}
+	if (literalStart >= 0)
+	{
+		out = WriteCount(out, literalStart - written);
+		out = WriteCount(out, literalEnd - literalStart);
+		for (int j = literalStart; j < literalEnd; j++)
+		{
+			*out++ = bytes[j] ^ (referenceBytes ? referenceBytes[j] : 0);
+		}
+	}
+	return (int)(out - start);
+}
+
+void Chip8Rewind::Apply(const U8 *in, int size, Chip8State &state)
+{
+	U8 *bytes = (U8 *)&state;
+	const U8 *end = in + size;
+	int position = 0;
+	while (in < end)
+	{
+		int unchanged, changed;
+		in = ReadCount(in, unchanged);
+		in = ReadCount(in, changed);
+		position += unchanged;
+		for (int i = 0; i < changed; i++)
+		{
+			bytes[position++] ^= *in++;
+		}
+	}
+}
+
+U32 Chip8Rewind::Place(U32 size)
+{
+	// Entries lie in the ring in the order they were recorded and the last one ends at head
+	// An entry that does not fit before the end of the buffer goes to offset 0, the rest of the buffer stays unused for this lap:
+	// whatever is still listed there is older than everything at the start, so it goes first
+	U32 offset = head;
+	if (head + size > capacity)
+	{
+		offset = 0;
+		while (!entries.empty() && entries.front().offset >= head)
+		{
+			EvictOldest();
+		}
+	}
+
+	while (!entries.empty())
+	{
+		const Entry &oldest = entries.front();
+		if (oldest.offset >= offset + size || oldest.offset + oldest.size <= offset) break;
+		EvictOldest();
+	}
+	return offset;
+}
+
+void Chip8Rewind::EvictOldest()
+{
+	// Its frames cannot be decoded without the keyframe
+	entries.pop_front();
+	while (!entries.empty() && !entries.front().keyframe)
+	{
+		entries.pop_front();
+	}
+}
+
+void Chip8Rewind::Record(const Chip8 &chip8)
+{
+	// Most frames write no memory at all, copying and comparing only the chunks written keeps a frame well under a microsecond
+	keyframeChunks |= chip8.UpdateState(current, &chip8 != source);
+	source = &chip8;
+
+	bool isKeyframe = forceKeyframe || sinceKeyframe >= keyframeInterval;
+	int size = Encode(current, isKeyframe ? nullptr : &keyframe, isKeyframe ? 0xFFFF : keyframeChunks, scratch);
+	U32 offset = (U32)size <= capacity ? Place(size) : 0;
+
+	// Not enough room for this keyframe group, it loses its keyframe and starts again
+	if (!isKeyframe && (entries.empty() || !entries.front().keyframe))
+	{
+		entries.clear();
+		head = 0;
+		isKeyframe = true;
+		size = Encode(current, nullptr, 0xFFFF, scratch);
+		offset = 0;
+	}
+
+	if ((U32)size > capacity)
+	{
+		// Ring too small for even one frame: nothing before it can be decoded any more, the next frame tries a keyframe
+		entries.clear();
+		head = 0;
+		forceKeyframe = true;
+		return;
+	}
+
+	memcpy(&buffer[offset], scratch, size);
+	Entry entry = { offset, (U32)size, isKeyframe };
+	entries.push_back(entry);
+	head = offset + size;
+
+	if (isKeyframe)
+	{
+		memcpy(&keyframe, &current, sizeof(Chip8State));
+		keyframeChunks = 0;
+		sinceKeyframe = 0;
+		forceKeyframe = false;
+	}
+	sinceKeyframe++;
+}
+
+void Chip8Rewind::Decode(int index, Chip8State &state) const
+{
+	int first = index;
+	while (!entries[first].keyframe)
+	{
+		--first;
+	}
+
+	memset(&state, 0, sizeof(Chip8State));
+	Apply(&buffer[entries[first].offset], entries[first].size, state);
+	if (first != index)
+	{
+		Apply(&buffer[entries[index].offset], entries[index].size, state);
+	}
+}
+
+bool Chip8Rewind::Restore(Chip8 &chip8, int age) const
+{
+	Chip8State state;
+	return GetState(age, state) && chip8.LoadState(state);
+}
+
+bool Chip8Rewind::GetState(int age, Chip8State &state) const
+{
+	if (age < 0 || age >= (int)entries.size()) return false;
+
+	Decode((int)entries.size() - 1 - age, state);
+	return true;
+}
+
+bool Chip8Rewind::StepBack(Chip8 &chip8)
+{
+	if (entries.size() < 2) return false;
+
+	entries.pop_back();
+	const Entry &last = entries.back();
+	head = last.offset + last.size;
+	forceKeyframe = true; // The next frame starts a new group, the keyframe of the last one is not at hand
+	return Restore(chip8, 0);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+
+#include "Chip8.h"
+
+// History of the machine state, one entry per frame, in a ring of fixed size
+// Every keyframeInterval frames the full state is stored, the frames in between as the XOR with that keyframe.
+// Both are run-length encoded: most of memory is ROM or zero and most of the display does not change, so an entry
+// is mostly one long run of zero bytes. When the ring is full the oldest keyframe and its frames go
+class Chip8Rewind
+{
+public:
+	static const size_t MAX_CAPACITY = (size_t)1 << 30; // Offsets in the ring are U32
+
+	Chip8Rewind(size_t capacityBytes = 4 << 20, int keyframeInterval = 300); // At most MAX_CAPACITY
+
+	void Record(const Chip8 &chip8); // After every frame
+	bool StepBack(Chip8 &chip8); // Load the frame before the last one recorded and forget the last one, false when there is none
+	bool Restore(Chip8 &chip8, int age) const; // Load a recorded frame without forgetting anything, age 0 is the last one
+	bool GetState(int age, Chip8State &state) const; // The same without loading it
+	void Clear();
+
+	int GetFrameCount() const { return (int)entries.size(); }
+	size_t GetUsedBytes() const; // Encoded frames and their index
+
+private:
+	struct Entry
+	{
+		U32 offset; // In buffer
+		U32 size;
+		bool keyframe;
+	};
+
+	static const int MAX_ENTRY_SIZE = sizeof(Chip8State) + 8; // Every byte changed: one run with two counts
+
+	// Runs of a count of unchanged bytes, a count of changed bytes and those bytes XOR the reference (zero for a keyframe)
+	// Memory outside memoryChunks (bit n for addresses n * 256 and up) is the same as in the reference and not compared
+	static int Encode(const Chip8State &state, const Chip8State *reference, U32 memoryChunks, U8 *out);
+	static void Apply(const U8 *in, int size, Chip8State &state); // XOR an entry into state
+	void Decode(int index, Chip8State &state) const;
+	U32 Place(U32 size); // Offset for the next entry, after dropping the entries in its way
+	void EvictOldest(); // Drop the oldest keyframe group
+
+	std::unique_ptr<U8[]> buffer;
+	U32 capacity;
+	U32 head = 0; // Where the next entry goes
+	int keyframeInterval;
+	std::deque<Entry> entries;
+
+	int sinceKeyframe = 0; // Frames recorded since the last keyframe
+	bool forceKeyframe = true; // The keyframe below does not match the last group in the ring
+	Chip8State keyframe; // State of the last keyframe recorded
+	Chip8State current; // State recorded last, updated with only the memory chunks written since
+	const Chip8 *source = nullptr; // Machine current was updated from, any other one is copied in full
+	U32 keyframeChunks = 0xFFFF; // Memory chunks written since the keyframe
+	U8 scratch[MAX_ENTRY_SIZE];
+};
@@ -0,0 +1,169 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen
+
+#include "Chip8Savestate.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+	bool IsLittleEndian()
+	{
+		const U16 probe = 1;
+		return *(const U8 *)&probe == 1;
+	}
+
+	void WriteLE16(U8 *out, U16 value)
+	{
+		out[0] = value & 0xFF;
+		out[1] = value >> 8;
+	}
+
+	void WriteLE32(U8 *out, U32 value)
+	{
+		for (int i = 0; i < 4; i++) out[i] = (value >> (i * 8)) & 0xFF;
+	}
+
+	U16 ReadLE16(const U8 *in)
+	{
+		return (U16)(in[0] | (in[1] << 8));
+	}
+
+	U32 ReadLE32(const U8 *in)
+	{
+		return in[0] | (in[1] << 8) | (in[2] << 16) | ((U32)in[3] << 24);
+	}
+
+	template <class T>
+	void Swap(T &value)
+	{
+		U8 *bytes = (U8 *)&value;
+		for (size_t i = 0; i < sizeof(T) / 2; i++)
+		{
+			U8 byte = bytes[i];
+			bytes[i] = bytes[sizeof(T) - 1 - i];
+			bytes[sizeof(T) - 1 - i] = byte;
+		}
+	}
+
+	const char magic[4] = { 'C', '8', 'S', 'T' };
+}
+
+// The offsets of version 1, a change here needs a new version and a conversion in Decode()
+static_assert(offsetof(Chip8State, display) == 4096, "savestate layout");
+static_assert(offsetof(Chip8State, stack) == 4352, "savestate layout");
+static_assert(offsetof(Chip8State, reg) == 4390, "savestate layout");
+static_assert(offsetof(Chip8State, randomState) == 4428, "savestate layout");
+
+void Chip8Savestate::Encode(const Chip8State &state, U8 *out)
+{
+	memcpy(out, magic, sizeof(magic));
+	WriteLE16(out + 4, VERSION);
+	WriteLE16(out + 6, HEADER_SIZE);
+	WriteLE32(out + 8, sizeof(Chip8State));
+
+	memcpy(out + HEADER_SIZE, &state, sizeof(Chip8State));
+	if (!IsLittleEndian())
+	{
+		Chip8State swapped;
+		memcpy(&swapped, &state, sizeof(Chip8State));
+		SwapBytes(swapped);
+		memcpy(out + HEADER_SIZE, &swapped, sizeof(Chip8State));
+	}
+}
+
+bool Chip8Savestate::Decode(const U8 *in, int size, Chip8State &state)
+{
+	if (size < HEADER_SIZE || memcmp(in, magic, sizeof(magic)) != 0) return false;
+
+	U16 version = ReadLE16(in + 4);
+	U16 headerSize = ReadLE16(in + 6);
+	U32 stateSize = ReadLE32(in + 8);
+	if (version != VERSION || headerSize != HEADER_SIZE || stateSize != sizeof(Chip8State) || size < SNAPSHOT_SIZE)
+	{
+		return false;
+	}
+
+	memcpy(&state, in + HEADER_SIZE, sizeof(Chip8State));
+	if (!IsLittleEndian())
+	{
+		SwapBytes(state);
+	}
+	return true;
+}
+
+void Chip8Savestate::SwapBytes(Chip8State &state)
+{
+	for (U64 &row : state.display) Swap(row);
+	for (U16 &entry : state.stack) Swap(entry);
+	Swap(state.regI);
+	Swap(state.regPC);
+	Swap(state.stackPointer);
+	Swap(state.randomState);
+}
+
+bool SavestateWriter::Write(const Chip8State &state)
+{
+	U8 snapshot[Chip8Savestate::SNAPSHOT_SIZE];
+	Chip8Savestate::Encode(state, snapshot);
+	return WriteBytes(snapshot, sizeof(snapshot));
+}
+
+bool SavestateReader::Read(Chip8State &state)
+{
+	U8 snapshot[Chip8Savestate::SNAPSHOT_SIZE];
+	if (!ReadBytes(snapshot, Chip8Savestate::HEADER_SIZE)) return false;
+
+	U32 size = ReadLE16(snapshot + 6) + ReadLE32(snapshot + 8);
+	if (size != Chip8Savestate::SNAPSHOT_SIZE)
+	{
+		return false;
+	}
+	return ReadBytes(snapshot + Chip8Savestate::HEADER_SIZE, size - Chip8Savestate::HEADER_SIZE) &&
+		Chip8Savestate::Decode(snapshot, size, state);
+}
+
+FileSavestateWriter::FileSavestateWriter(const char *path)
+{
+	file = fopen(path, "wb");
+}
+
+FileSavestateWriter::~FileSavestateWriter()
+{
+	if (file) fclose(file);
+}
+
+bool FileSavestateWriter::WriteBytes(const U8 *data, int size)
+{
+	return file != NULL && fwrite(data, 1, size, file) == (size_t)size;
+}
+
+FileSavestateReader::FileSavestateReader(const char *path)
+{
+	file = fopen(path, "rb");
+}
+
+FileSavestateReader::~FileSavestateReader()
+{
+	if (file) fclose(file);
+}
+
+bool FileSavestateReader::ReadBytes(U8 *data, int size)
+{
+	return file != NULL && fread(data, 1, size, file) == (size_t)size;
+}
+
+bool ArenaSavestateWriter::WriteBytes(const U8 *data, int size)
+{
+	arena.bytes.insert(arena.bytes.end(), data, data + size);
+	return true;
+}
+
+bool ArenaSavestateReader::ReadBytes(U8 *data, int size)
+{
+	if (position + size > arena.GetSize()) return false;
+
+	memcpy(data, arena.GetData() + position, size);
+	position += size;
+	return true;
+}
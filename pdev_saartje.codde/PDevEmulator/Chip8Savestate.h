@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "Chip8.h"
+
+// Versioned binary snapshots of Chip8State, for files, bug reports and in-memory history
+// A snapshot is a header followed by the state:
+//   "C8ST"   magic
+//   U16      format version
+//   U16      size of the header
+//   U32      size of the state that follows
+// Every number is little endian. On little-endian hosts Chip8State is laid out exactly like the state in a snapshot,
+// so encoding and decoding are a memcpy; big-endian hosts swap the multi-byte fields
+class Chip8Savestate
+{
+public:
+	static const U16 VERSION = 1;
+	static const int HEADER_SIZE = 12;
+	static const int SNAPSHOT_SIZE = HEADER_SIZE + sizeof(Chip8State);
+
+	static void Encode(const Chip8State &state, U8 *out); // Writes SNAPSHOT_SIZE bytes
+	static bool Decode(const U8 *in, int size, Chip8State &state); // False for another format, version or size
+
+private:
+	static void SwapBytes(Chip8State &state);
+};
+
+// Destination of a stream of snapshots
+class SavestateWriter
+{
+public:
+	virtual ~SavestateWriter() {}
+	bool Write(const Chip8State &state); // Appends one snapshot
+
+protected:
+	virtual bool WriteBytes(const U8 *data, int size) = 0;
+};
+
+// Source of a stream of snapshots, read in the order they were written
+class SavestateReader
+{
+public:
+	virtual ~SavestateReader() {}
+	bool Read(Chip8State &state); // False at the end of the stream or on a snapshot that cannot be decoded
+
+protected:
+	virtual bool ReadBytes(U8 *data, int size) = 0;
+};
+
+class FileSavestateWriter : public SavestateWriter
+{
+public:
+	FileSavestateWriter(const char *path);
+	~FileSavestateWriter() override;
+	bool IsOpen() const { return file != NULL; }
+
+protected:
+	bool WriteBytes(const U8 *data, int size) override;
+
+private:
+	FILE *file;
+};
+
+class FileSavestateReader : public SavestateReader
+{
+public:
+	FileSavestateReader(const char *path);
+	~FileSavestateReader() override;
+	bool IsOpen() const { return file != NULL; }
+
+protected:
+	bool ReadBytes(U8 *data, int size) override;
+
+private:
+	FILE *file;
+};
+
+// Snapshots back to back in one block of memory, which only grows when Reserve() did not make it large enough
+class SavestateArena
+{
+public:
+	void Reserve(int snapshots) { bytes.reserve((size_t)snapshots * Chip8Savestate::SNAPSHOT_SIZE); }
+	void Clear() { bytes.clear(); }
+	size_t GetSize() const { return bytes.size(); }
+	const U8 *GetData() const { return bytes.data(); }
+
+private:
+	friend class ArenaSavestateWriter;
+	std::vector<U8> bytes;
+};
+
+class ArenaSavestateWriter : public SavestateWriter
+{
+public:
+	ArenaSavestateWriter(SavestateArena &arena) : arena(arena) {}
+
+protected:
+	bool WriteBytes(const U8 *data, int size) override;
+
+private:
+	SavestateArena &arena;
+};
+
+class ArenaSavestateReader : public SavestateReader
+{
+public:
+	ArenaSavestateReader(const SavestateArena &arena) : arena(arena) {}
+	void Seek(size_t offset) { position = offset; } // Offset in bytes, 0 for the first snapshot
+
+protected:
+	bool ReadBytes(U8 *data, int size) override;
+
+private:
+	const SavestateArena &arena;
+	size_t position = 0;
+};
@@ -0,0 +1,110 @@
+#include "Chip8Scheduler.h"
+#include "Chip8Trace.h"
+
+namespace
+{
+	const long long frameLength = 1000000000; // One frame in the units of the accumulator
+	const int maxCatchUp = 15; // Frames run at most to catch up, the rest of a longer stall (breakpoint, suspended machine) is dropped
+	const int unlimitedBatch = 4096; // Instructions between deadline checks with UNLIMITED instructions per second
+}
+
+Chip8Scheduler::Chip8Scheduler(Chip8 &chip8) : chip8(chip8), lastUpdate(Clock::now())
+{
+}
+
+void Chip8Scheduler::SetInstructionsPerSecond(int ips)
+{
+	instructionsPerSecond = ips < 0 ? UNLIMITED : ips;
+	frameInSecond = 0;
+}
+
+void Chip8Scheduler::SetTurbo(bool on)
+{
+	turbo = on;
+}
+
+void Chip8Scheduler::Reset(Clock::time_point now)
+{
+	lastUpdate = now;
+	accumulator = 0;
+}
+
+int Chip8Scheduler::FramesDue(Clock::time_point now)
+{
+	long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastUpdate).count();
+	lastUpdate = now;
+
+	if (turbo)
+	{
+		accumulator = 0;
+		return 1;
+	}
+
+	accumulator += elapsed * 60;
+	int frames = (int)(accumulator / frameLength);
+	accumulator %= frameLength;
+
+	if (frames > maxCatchUp)
+	{
+		frames = maxCatchUp;
+	}
+	return frames;
+}
+
+Chip8Scheduler::Clock::time_point Chip8Scheduler::NextFrame() const
+{
+	return lastUpdate + std::chrono::nanoseconds((frameLength - accumulator + 59) / 60);
+}
+
+bool Chip8Scheduler::RunFrame(Clock::time_point deadline)
+{
+	{
+		Chip8Trace::Scope trace("Instructions");
+		if (instructionsPerSecond == UNLIMITED)
+		{
+			do
+			{
+				chip8.Run(unlimitedBatch);
+			} while (!chip8.IsIdle() && !chip8.IsWaitingForFrame() && Clock::now() < deadline);
+		}
+		else
+		{
+			chip8.Run(NextFrameInstructions());
+		}
+	}
+	Chip8Trace::Scope trace("Timers");
+	return TickTimers();
+}
+
+void Chip8Scheduler::RunAhead(int frames)
+{
+	int frame = frameInSecond;
+	for (int i = 0; i < frames; i++)
+	{
+		RunFrame(Clock::time_point()); // Deadline long past
+	}
+	frameInSecond = frame;
+}
+
+int Chip8Scheduler::NextFrameInstructions()
+{
+	// Frame n of the second runs floor((n + 1) * ips / 60) - floor(n * ips / 60) instructions, ips per 60 frames exactly
+	long long ips = instructionsPerSecond;
+	int count = (int)((frameInSecond + 1) * ips / 60 - frameInSecond * ips / 60);
+	frameInSecond = (frameInSecond + 1) % 60;
+	return count;
+}
+
+bool Chip8Scheduler::TickTimers()
+{
+	if (chip8.delayTimer > 0)
+	{
+		chip8.delayTimer--;
+	}
+	bool sound = chip8.soundTimer > 0;
+	if (chip8.soundTimer > 0)
+	{
+		chip8.soundTimer--;
+	}
+	return sound;
+}
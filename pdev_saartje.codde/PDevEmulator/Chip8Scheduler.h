@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+
+#include "Chip8.h"
+
+// Decides how much the emulator runs, independent of the display refresh rate
+// Emulated time advances in frames of exactly 1/60 s: the instructions of the frame at the configured rate,
+// followed by one tick of the delay and sound timers
+class Chip8Scheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	static const int UNLIMITED = 0; // Instructions per second: run instructions until the frame is over in real time
+
+	Chip8Scheduler(Chip8 &chip8);
+
+	void SetInstructionsPerSecond(int ips);
+	int GetInstructionsPerSecond() const { return instructionsPerSecond; }
+	void SetTurbo(bool on); // Run frames back to back instead of 60 per second of real time
+	bool GetTurbo() const { return turbo; }
+
+	void Reset(Clock::time_point now); // Start counting real time from now, the frames missed before are dropped
+	int FramesDue(Clock::time_point now); // Number of frames to run to catch up with real time, always 1 in turbo
+	Clock::time_point NextFrame() const; // When the next frame is due in real time
+
+	// Run one frame; with UNLIMITED instructions per second the instructions run in batches until deadline,
+	// or until the program only waits for the timers, the keys or the next frame
+	// Returns whether the buzzer sounds during the frame (the sound timer is running)
+	bool RunFrame(Clock::time_point deadline);
+
+	// Run frames that the caller throws away again by loading a savestate taken before (run-ahead)
+	// Like catching up they get one batch of UNLIMITED instructions; the frame counter is left where it was
+	void RunAhead(int frames);
+
+	// The two halves of RunFrame() at a fixed rate, for callers that want to run part of a frame
+	int NextFrameInstructions(); // Instructions in the next frame, moves on to the frame after it
+	bool TickTimers(); // Returns whether the buzzer sounded during the frame
+
+private:
+	Chip8 &chip8;
+
+	int instructionsPerSecond = 500;
+	bool turbo = false;
+	int frameInSecond = 0; // Spreads instructionsPerSecond over 60 frames without rounding errors
+
+	Clock::time_point lastUpdate;
+	long long accumulator = 0; // Real time not emulated yet, in 1/60 nanoseconds so that a frame is exactly 10^9
+};
@@ -0,0 +1,133 @@
+#include "Chip8Thread.h"
+#include "Chip8Trace.h"
+
+#include <cstring>
+
+Chip8Thread::Chip8Thread(Chip8 &chip8, Chip8Audio &audio) : chip8(chip8), audio(audio), scheduler(chip8), rewind(new Chip8Rewind())
+{
+}
+
+Chip8Thread::~Chip8Thread()
+{
+	Stop();
+}
+
+void Chip8Thread::Start()
+{
+	if (running) return;
+
+	running = true;
+	thread = std::thread(&Chip8Thread::Loop, this);
+}
+
+void Chip8Thread::Stop()
+{
+	running = false;
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+	audio.SetTone(false);
+}
+
+void Chip8Thread::SetRewindCapacity(size_t bytes)
+{
+	rewind.reset(bytes > 0 ? new Chip8Rewind(bytes) : nullptr);
+}
+
+void Chip8Thread::ClearRewind()
+{
+	if (rewind) rewind->Clear();
+}
+
+double Chip8Thread::GetRunAheadMicroseconds() const
+{
+	long long count = runAheadFrames;
+	return count > 0 ? runAheadNanoseconds / 1000.0 / count : 0.0;
+}
+
+void Chip8Thread::Keypress(U8 k, int action)
+{
+	KeyEvent event = { k, action };
+	keyEvents.Push(event); // Only drops keys when the emulation thread is 64 events behind
+}
+
+void Chip8Thread::Loop()
+{
+	Chip8Trace::SetThreadName("Emulation");
+	scheduler.Reset(Chip8Scheduler::Clock::now());
+
+	while (running)
+	{
+		KeyEvent event;
+		while (keyEvents.Pop(event))
+		{
+			chip8.Keypress(event.key, event.action);
+		}
+
+		Chip8Scheduler::Clock::time_point now = Chip8Scheduler::Clock::now();
+		int due = scheduler.FramesDue(now);
+		for (int i = 0; i < due; i++)
+		{
+			if (rewinding && rewind)
+			{
+				// One recorded frame back per frame, silent; stays on the oldest one when the history runs out
+				Chip8Trace::Scope trace("Rewind");
+				rewind->StepBack(chip8);
+				audio.SetTone(false);
+				continue;
+			}
+
+			// Catching up and turbo frames only get one batch of UNLIMITED instructions, the last one runs until the next frame is due
+			bool last = i == due - 1 && !scheduler.GetTurbo();
+			bool sound = scheduler.RunFrame(last ? scheduler.NextFrame() : now);
+
+			if (rewind)
+			{
+				Chip8Trace::Scope trace("Record");
+				rewind->Record(chip8);
+			}
+
+			Chip8Trace::Scope trace("Sound");
+			audio.SetTone(sound);
+		}
+
+		// Publish a frame only when the display changed, the render thread keeps showing the previous one
+		if (due > 0)
+		{
+			bool ahead = runAhead > 0 && !rewinding;
+			long long aheadNanoseconds = 0;
+			if (ahead)
+			{
+				Chip8Trace::Scope trace("Run-ahead");
+				Chip8Scheduler::Clock::time_point start = Chip8Scheduler::Clock::now();
+				chip8.SaveState(runAheadState);
+				scheduler.RunAhead(runAhead);
+				aheadNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Chip8Scheduler::Clock::now() - start).count();
+			}
+			{
+				Chip8Trace::Scope trace("Draw");
+				if (chip8.Draw() != 0)
+				{
+					memcpy(frames.Back().display, chip8.textureBuffer, sizeof(chip8.textureBuffer));
+					frames.Publish();
+				}
+			}
+			if (ahead)
+			{
+				// Back to the real frame, the rows that differ from the frame shown are dirty again for the next Draw()
+				Chip8Trace::Scope trace("Restore");
+				Chip8Scheduler::Clock::time_point start = Chip8Scheduler::Clock::now();
+				chip8.LoadState(runAheadState);
+				runAheadNanoseconds += aheadNanoseconds + std::chrono::duration_cast<std::chrono::nanoseconds>(Chip8Scheduler::Clock::now() - start).count();
+				runAheadFrames++;
+			}
+		}
+
+		if (!scheduler.GetTurbo())
+		{
+			Chip8Trace::Scope trace("Sleep");
+			std::this_thread::sleep_until(scheduler.NextFrame());
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "Chip8.h"
+#include "Chip8Audio.h"
+#include "Chip8Rewind.h"
+#include "Chip8Scheduler.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+// Runs a Chip8 on its own thread, frames as decided by a Chip8Scheduler, and Draw() after them
+// Finished frames go to the render thread through a triple buffer and keys come in through a queue,
+// so a slow buffer swap on the render thread no longer delays emulation; the sound timer drives a Chip8Audio
+// Every frame is recorded in a Chip8Rewind, while rewinding frames are taken back from it instead of run
+// With run-ahead the frame shown is the one N frames ahead with the keys held now, after which a savestate goes back:
+// a key press shows up N frames earlier at the cost of running N + 1 frames per frame
+class Chip8Thread
+{
+public:
+	struct Frame
+	{
+		U64 display[32]; // Copy of Chip8::textureBuffer
+	};
+
+	Chip8Thread(Chip8 &chip8, Chip8Audio &audio);
+	~Chip8Thread();
+
+	// The Chip8 must only be touched by other threads while the thread is stopped
+	void Start();
+	void Stop();
+	Chip8Scheduler &Scheduler() { return scheduler; } // Only change the settings while the thread is stopped
+	void SetRewindCapacity(size_t bytes); // 0 turns recording off, only while the thread is stopped
+	void ClearRewind(); // After loading another ROM, only while the thread is stopped
+	void SetRunAhead(int frames) { runAhead = frames; } // 0 turns it off, only while the thread is stopped
+	double GetRunAheadMicroseconds() const; // Average time run-ahead added to a frame shown
+
+	// Called from the render thread
+	void Keypress(U8 k, int action);
+	void SetRewinding(bool on) { rewinding = on; }
+	TripleBuffer<Frame> &Frames() { return frames; }
+
+private:
+	struct KeyEvent
+	{
+		U8 key;
+		int action;
+	};
+
+	void Loop();
+
+	Chip8 &chip8;
+	Chip8Audio &audio;
+	Chip8Scheduler scheduler;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> rewinding{ false };
+	std::unique_ptr<Chip8Rewind> rewind;
+
+	int runAhead = 0;
+	Chip8State runAheadState; // The real state while the frames ahead run
+	std::atomic<long long> runAheadNanoseconds{ 0 };
+	std::atomic<long long> runAheadFrames{ 0 };
+
+	TripleBuffer<Frame> frames;
+	SpscQueue<KeyEvent, 64> keyEvents;
+};
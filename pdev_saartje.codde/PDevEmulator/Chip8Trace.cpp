@@ -0,0 +1,141 @@
+#define _CRT_SECURE_NO_WARNINGS // fopen
+
+#include "Chip8Trace.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		const char *name;
+		long long begin; // Nanoseconds since Start()
+		long long duration;
+	};
+
+	// Events of one thread; kept after the thread ends, until the program exits
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]> events;
+		std::atomic<int> count{ 0 }; // Events written, published with a release store after each event
+		std::atomic<int> dropped{ 0 };
+		std::atomic<const char *> name{ nullptr };
+		int id;
+	};
+
+	std::mutex registryMutex; // Only taken when a thread records its first event, by SetThreadName() and by Write()
+	std::vector<std::unique_ptr<ThreadBuffer>> registry;
+	int capacity = 0;
+	Chip8Trace::Clock::time_point origin;
+
+	thread_local ThreadBuffer *threadBuffer = nullptr;
+	thread_local const char *threadName = nullptr;
+
+	ThreadBuffer *Register()
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+		buffer->events.reset(new Event[capacity]);
+		buffer->name = threadName;
+		buffer->id = (int)registry.size() + 1;
+		threadBuffer = buffer.get();
+		registry.push_back(std::move(buffer));
+		return threadBuffer;
+	}
+
+	void WriteString(FILE *out, const char *text)
+	{
+		fputc('"', out);
+		for (; *text; text++)
+		{
+			if (*text == '"' || *text == '\\') fputc('\\', out);
+			fputc(*text, out);
+		}
+		fputc('"', out);
+	}
+}
+
+std::atomic<bool> Chip8Trace::enabled{ false };
+
+void Chip8Trace::Start(int eventsPerThread)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	if (enabled) return;
+
+	capacity = eventsPerThread;
+	origin = Clock::now();
+	enabled = true;
+}
+
+void Chip8Trace::SetThreadName(const char *name)
+{
+	threadName = name;
+	if (threadBuffer)
+	{
+		threadBuffer->name = name;
+	}
+}
+
+void Chip8Trace::Record(const char *name, Clock::time_point begin, Clock::time_point end)
+{
+	ThreadBuffer *buffer = threadBuffer ? threadBuffer : Register();
+
+	int count = buffer->count.load(std::memory_order_relaxed);
+	if (count == capacity)
+	{
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Event &event = buffer->events[count];
+	event.name = name;
+	event.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - origin).count();
+	event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+bool Chip8Trace::Write(const char *path)
+{
+	FILE *out = fopen(path, "w");
+	if (out == NULL) return false;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	// Complete events ("X") in microseconds, preceded by the names of the threads
+	fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"PDevEmulator\"}}");
+	for (const std::unique_ptr<ThreadBuffer> &buffer : registry)
+	{
+		const char *name = buffer->name.load();
+		fprintf(out, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", buffer->id);
+		if (name) WriteString(out, name);
+		else fprintf(out, "\"thread %d\"", buffer->id);
+		fprintf(out, "}}");
+	}
+
+	for (const std::unique_ptr<ThreadBuffer> &buffer : registry)
+	{
+		int count = buffer->count.load(std::memory_order_acquire);
+		for (int i = 0; i < count; i++)
+		{
+			const Event &event = buffer->events[i];
+			fprintf(out, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld.%03lld,\"dur\":%lld.%03lld,\"name\":", buffer->id,
+				event.begin / 1000, event.begin % 1000, event.duration / 1000, event.duration % 1000);
+			WriteString(out, event.name);
+			fprintf(out, "}");
+		}
+		int dropped = buffer->dropped.load(std::memory_order_relaxed);
+		if (dropped > 0)
+		{
+			fprintf(stderr, "Trace buffer of thread %d was full, %d spans were not recorded\n", buffer->id, dropped);
+		}
+	}
+	fprintf(out, "\n]}\n");
+
+	bool written = ferror(out) == 0;
+	fclose(out);
+	return written;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+// Spans of the phases of a frame on every thread, written as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+// Every thread records into a buffer of its own that only it writes, so recording takes no lock; the spans are
+// written out with Write(), which may run while the threads keep recording. Nothing is recorded before Start()
+//
+//	{
+//		Chip8Trace::Scope trace("glfwSwapBuffers"); // Span from here to the end of the block, the name must be a literal
+//		glfwSwapBuffers(window);
+//	}
+class Chip8Trace
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	static void Start(int eventsPerThread = 1 << 18); // A thread that fills its buffer stops recording
+	static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static void SetThreadName(const char *name); // Name of the track of the calling thread, a literal
+	static bool Write(const char *path);
+
+	class Scope
+	{
+	public:
+		explicit Scope(const char *name) : name(IsEnabled() ? name : nullptr)
+		{
+			if (this->name) start = Clock::now();
+		}
+		~Scope()
+		{
+			End();
+		}
+		void End() // End the span before the end of the block
+		{
+			if (name) Record(name, start, Clock::now());
+			name = nullptr;
+		}
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+
+	private:
+		const char *name;
+		Clock::time_point start;
+	};
+
+private:
+	static void Record(const char *name, Clock::time_point begin, Clock::time_point end);
+	static std::atomic<bool> enabled;
+};
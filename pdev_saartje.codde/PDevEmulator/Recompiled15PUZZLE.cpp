@@ -0,0 +1,626 @@
+// Generated by Chip8Recompiler from 15PUZZLE, do not edit
+#include "Chip8Recompiled.h"
+
+#define STORE() s.reg[0] = V0; s.reg[1] = V1; s.reg[2] = V2; s.reg[3] = V3; s.reg[4] = V4; s.reg[5] = V5; s.reg[6] = V6; s.reg[7] = V7; s.reg[8] = V8; s.reg[9] = V9; s.reg[10] = VA; s.reg[11] = VB; s.reg[12] = VC; s.reg[13] = VD; s.reg[14] = VE; s.reg[15] = VF; *s.regI = I; *s.stackPointer = SP; *s.regPC = PC
+#define LOAD() V0 = s.reg[0]; V1 = s.reg[1]; V2 = s.reg[2]; V3 = s.reg[3]; V4 = s.reg[4]; V5 = s.reg[5]; V6 = s.reg[6]; V7 = s.reg[7]; V8 = s.reg[8]; V9 = s.reg[9]; VA = s.reg[10]; VB = s.reg[11]; VC = s.reg[12]; VD = s.reg[13]; VE = s.reg[14]; VF = s.reg[15]; I = *s.regI; SP = *s.stackPointer; PC = *s.regPC
+
+namespace
+{
+const U32 code[128] =
+{
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x000000FF,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000
+};
+
+int Run(RecompiledState &s, int count)
+{
+	U8 V0 = s.reg[0], V1 = s.reg[1], V2 = s.reg[2], V3 = s.reg[3], V4 = s.reg[4], V5 = s.reg[5], V6 = s.reg[6], V7 = s.reg[7], V8 = s.reg[8], V9 = s.reg[9], VA = s.reg[10], VB = s.reg[11], VC = s.reg[12], VD = s.reg[13], VE = s.reg[14], VF = s.reg[15];
+	U16 I = *s.regI;
+	U16 SP = *s.stackPointer;
+	U16 PC = *s.regPC;
+	int executed = 0;
+
+dispatch:
+	switch (PC)
+	{
+	case 0x200:
+		if (count - executed < 3) { PC = 0x200; goto exit; }
+		// 0x200: 00E0
+		executed++;
+		PC = 0x200; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x202: 6C00
+		executed++;
+		VC = 0x000;
+		// 0x204: 4C00
+		executed++;
+		if (VC != 0x000) goto B_208;
+		goto B_206;
+
+	case 0x206:
+	B_206:
+		if (count - executed < 1) { PC = 0x206; goto exit; }
+		// 0x206: 6E0F
+		executed++;
+		VE = 0x00F;
+		goto B_208;
+
+	case 0x208:
+	B_208:
+		if (count - executed < 4) { PC = 0x208; goto exit; }
+		// 0x208: A203
+		executed++;
+		I = 0x203;
+		// 0x20A: 6020
+		executed++;
+		V0 = 0x020;
+		// 0x20C: F055
+		executed++;
+		PC = 0x20C; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x20E: 00E0
+		executed++;
+		PC = 0x20E; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		goto B_210;
+
+	case 0x210:
+	B_210:
+		if (count - executed < 1) { PC = 0x210; goto exit; }
+		// 0x210: 22BE
+		executed++;
+		s.stack[SP & 0xF] = 0x212; SP = (SP & 0xF) + 1; goto B_2BE;
+
+	case 0x212:
+		if (count - executed < 1) { PC = 0x212; goto exit; }
+		// 0x212: 2276
+		executed++;
+		s.stack[SP & 0xF] = 0x214; SP = (SP & 0xF) + 1; goto B_276;
+
+	case 0x214:
+		if (count - executed < 1) { PC = 0x214; goto exit; }
+		// 0x214: 228E
+		executed++;
+		s.stack[SP & 0xF] = 0x216; SP = (SP & 0xF) + 1; goto B_28E;
+
+	case 0x216:
+		if (count - executed < 1) { PC = 0x216; goto exit; }
+		// 0x216: 225E
+		executed++;
+		s.stack[SP & 0xF] = 0x218; SP = (SP & 0xF) + 1; goto B_25E;
+
+	case 0x218:
+		if (count - executed < 1) { PC = 0x218; goto exit; }
+		// 0x218: 2246
+		executed++;
+		s.stack[SP & 0xF] = 0x21A; SP = (SP & 0xF) + 1; goto B_246;
+
+	case 0x21A:
+		if (count - executed < 1) { PC = 0x21A; goto exit; }
+		// 0x21A: 1210
+		executed++;
+		PC = 0x210; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_210;
+
+	case 0x21C:
+	B_21C:
+		if (count - executed < 3) { PC = 0x21C; goto exit; }
+		// 0x21C: 6100
+		executed++;
+		V1 = 0x000;
+		// 0x21E: 6217
+		executed++;
+		V2 = 0x017;
+		// 0x220: 6304
+		executed++;
+		V3 = 0x004;
+		goto B_222;
+
+	case 0x222:
+	B_222:
+		if (count - executed < 1) { PC = 0x222; goto exit; }
+		// 0x222: 4110
+		executed++;
+		if (V1 != 0x010) goto B_226;
+		goto B_224;
+
+	case 0x224:
+	B_224:
+		if (count - executed < 1) { PC = 0x224; goto exit; }
+		// 0x224: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x226:
+	B_226:
+		if (count - executed < 4) { PC = 0x226; goto exit; }
+		// 0x226: A2E8
+		executed++;
+		I = 0x2E8;
+		// 0x228: F11E
+		executed++;
+		VF = (I + V1) > 0xFFF ? 1 : 0; I += V1;
+		// 0x22A: F065
+		executed++;
+		PC = 0x22A; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x22C: 4000
+		executed++;
+		if (V0 != 0x000) goto B_230;
+		goto B_22E;
+
+	case 0x22E:
+	B_22E:
+		if (count - executed < 1) { PC = 0x22E; goto exit; }
+		// 0x22E: 1234
+		executed++;
+		goto B_234;
+
+	case 0x230:
+	B_230:
+		if (count - executed < 2) { PC = 0x230; goto exit; }
+		// 0x230: F029
+		executed++;
+		I = V0 * 5;
+		// 0x232: D235
+		executed++;
+		PC = 0x232; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		goto B_234;
+
+	case 0x234:
+	B_234:
+		if (count - executed < 5) { PC = 0x234; goto exit; }
+		// 0x234: 7101
+		executed++;
+		V1 += 0x001;
+		// 0x236: 7205
+		executed++;
+		V2 += 0x005;
+		// 0x238: 6403
+		executed++;
+		V4 = 0x003;
+		// 0x23A: 8412
+		executed++;
+		V4 &= V1;
+		// 0x23C: 3400
+		executed++;
+		if (V4 == 0x000) goto B_240;
+		goto B_23E;
+
+	case 0x23E:
+	B_23E:
+		if (count - executed < 1) { PC = 0x23E; goto exit; }
+		// 0x23E: 1222
+		executed++;
+		PC = 0x222; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_222;
+
+	case 0x240:
+	B_240:
+		if (count - executed < 3) { PC = 0x240; goto exit; }
+		// 0x240: 6217
+		executed++;
+		V2 = 0x017;
+		// 0x242: 7306
+		executed++;
+		V3 += 0x006;
+		// 0x244: 1222
+		executed++;
+		PC = 0x222; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_222;
+
+	case 0x246:
+	B_246:
+		if (count - executed < 5) { PC = 0x246; goto exit; }
+		// 0x246: 6403
+		executed++;
+		V4 = 0x003;
+		// 0x248: 84E2
+		executed++;
+		V4 &= VE;
+		// 0x24A: 6503
+		executed++;
+		V5 = 0x003;
+		// 0x24C: 85D2
+		executed++;
+		V5 &= VD;
+		// 0x24E: 9450
+		executed++;
+		if (V4 != V5) goto B_252;
+		goto B_250;
+
+	case 0x250:
+	B_250:
+		if (count - executed < 1) { PC = 0x250; goto exit; }
+		// 0x250: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x252:
+	B_252:
+		if (count - executed < 1) { PC = 0x252; goto exit; }
+		// 0x252: 4403
+		executed++;
+		if (V4 != 0x003) goto B_256;
+		goto B_254;
+
+	case 0x254:
+	B_254:
+		if (count - executed < 1) { PC = 0x254; goto exit; }
+		// 0x254: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x256:
+	B_256:
+		if (count - executed < 3) { PC = 0x256; goto exit; }
+		// 0x256: 6401
+		executed++;
+		V4 = 0x001;
+		// 0x258: 84E4
+		executed++;
+		VF = (V4 + VE) > 255 ? 1 : 0; V4 += VE;
+		// 0x25A: 22A6
+		executed++;
+		s.stack[SP & 0xF] = 0x25C; SP = (SP & 0xF) + 1; goto B_2A6;
+
+	case 0x25C:
+		if (count - executed < 1) { PC = 0x25C; goto exit; }
+		// 0x25C: 1246
+		executed++;
+		PC = 0x246; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_246;
+
+	case 0x25E:
+	B_25E:
+		if (count - executed < 5) { PC = 0x25E; goto exit; }
+		// 0x25E: 6403
+		executed++;
+		V4 = 0x003;
+		// 0x260: 84E2
+		executed++;
+		V4 &= VE;
+		// 0x262: 6503
+		executed++;
+		V5 = 0x003;
+		// 0x264: 85D2
+		executed++;
+		V5 &= VD;
+		// 0x266: 9450
+		executed++;
+		if (V4 != V5) goto B_26A;
+		goto B_268;
+
+	case 0x268:
+	B_268:
+		if (count - executed < 1) { PC = 0x268; goto exit; }
+		// 0x268: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x26A:
+	B_26A:
+		if (count - executed < 1) { PC = 0x26A; goto exit; }
+		// 0x26A: 4400
+		executed++;
+		if (V4 != 0x000) goto B_26E;
+		goto B_26C;
+
+	case 0x26C:
+	B_26C:
+		if (count - executed < 1) { PC = 0x26C; goto exit; }
+		// 0x26C: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x26E:
+	B_26E:
+		if (count - executed < 3) { PC = 0x26E; goto exit; }
+		// 0x26E: 64FF
+		executed++;
+		V4 = 0x0FF;
+		// 0x270: 84E4
+		executed++;
+		VF = (V4 + VE) > 255 ? 1 : 0; V4 += VE;
+		// 0x272: 22A6
+		executed++;
+		s.stack[SP & 0xF] = 0x274; SP = (SP & 0xF) + 1; goto B_2A6;
+
+	case 0x274:
+		if (count - executed < 1) { PC = 0x274; goto exit; }
+		// 0x274: 125E
+		executed++;
+		PC = 0x25E; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_25E;
+
+	case 0x276:
+	B_276:
+		if (count - executed < 5) { PC = 0x276; goto exit; }
+		// 0x276: 640C
+		executed++;
+		V4 = 0x00C;
+		// 0x278: 84E2
+		executed++;
+		V4 &= VE;
+		// 0x27A: 650C
+		executed++;
+		V5 = 0x00C;
+		// 0x27C: 85D2
+		executed++;
+		V5 &= VD;
+		// 0x27E: 9450
+		executed++;
+		if (V4 != V5) goto B_282;
+		goto B_280;
+
+	case 0x280:
+	B_280:
+		if (count - executed < 1) { PC = 0x280; goto exit; }
+		// 0x280: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x282:
+	B_282:
+		if (count - executed < 1) { PC = 0x282; goto exit; }
+		// 0x282: 4400
+		executed++;
+		if (V4 != 0x000) goto B_286;
+		goto B_284;
+
+	case 0x284:
+	B_284:
+		if (count - executed < 1) { PC = 0x284; goto exit; }
+		// 0x284: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x286:
+	B_286:
+		if (count - executed < 3) { PC = 0x286; goto exit; }
+		// 0x286: 64FC
+		executed++;
+		V4 = 0x0FC;
+		// 0x288: 84E4
+		executed++;
+		VF = (V4 + VE) > 255 ? 1 : 0; V4 += VE;
+		// 0x28A: 22A6
+		executed++;
+		s.stack[SP & 0xF] = 0x28C; SP = (SP & 0xF) + 1; goto B_2A6;
+
+	case 0x28C:
+		if (count - executed < 1) { PC = 0x28C; goto exit; }
+		// 0x28C: 1276
+		executed++;
+		PC = 0x276; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_276;
+
+	case 0x28E:
+	B_28E:
+		if (count - executed < 5) { PC = 0x28E; goto exit; }
+		// 0x28E: 640C
+		executed++;
+		V4 = 0x00C;
+		// 0x290: 84E2
+		executed++;
+		V4 &= VE;
+		// 0x292: 650C
+		executed++;
+		V5 = 0x00C;
+		// 0x294: 85D2
+		executed++;
+		V5 &= VD;
+		// 0x296: 9450
+		executed++;
+		if (V4 != V5) goto B_29A;
+		goto B_298;
+
+	case 0x298:
+	B_298:
+		if (count - executed < 1) { PC = 0x298; goto exit; }
+		// 0x298: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x29A:
+	B_29A:
+		if (count - executed < 1) { PC = 0x29A; goto exit; }
+		// 0x29A: 440C
+		executed++;
+		if (V4 != 0x00C) goto B_29E;
+		goto B_29C;
+
+	case 0x29C:
+	B_29C:
+		if (count - executed < 1) { PC = 0x29C; goto exit; }
+		// 0x29C: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x29E:
+	B_29E:
+		if (count - executed < 3) { PC = 0x29E; goto exit; }
+		// 0x29E: 6404
+		executed++;
+		V4 = 0x004;
+		// 0x2A0: 84E4
+		executed++;
+		VF = (V4 + VE) > 255 ? 1 : 0; V4 += VE;
+		// 0x2A2: 22A6
+		executed++;
+		s.stack[SP & 0xF] = 0x2A4; SP = (SP & 0xF) + 1; goto B_2A6;
+
+	case 0x2A4:
+		if (count - executed < 1) { PC = 0x2A4; goto exit; }
+		// 0x2A4: 128E
+		executed++;
+		PC = 0x28E; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_28E;
+
+	case 0x2A6:
+	B_2A6:
+		if (count - executed < 12) { PC = 0x2A6; goto exit; }
+		// 0x2A6: A2E8
+		executed++;
+		I = 0x2E8;
+		// 0x2A8: F41E
+		executed++;
+		VF = (I + V4) > 0xFFF ? 1 : 0; I += V4;
+		// 0x2AA: F065
+		executed++;
+		PC = 0x2AA; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2AC: A2E8
+		executed++;
+		I = 0x2E8;
+		// 0x2AE: FE1E
+		executed++;
+		VF = (I + VE) > 0xFFF ? 1 : 0; I += VE;
+		// 0x2B0: F055
+		executed++;
+		PC = 0x2B0; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2B2: 6000
+		executed++;
+		V0 = 0x000;
+		// 0x2B4: A2E8
+		executed++;
+		I = 0x2E8;
+		// 0x2B6: F41E
+		executed++;
+		VF = (I + V4) > 0xFFF ? 1 : 0; I += V4;
+		// 0x2B8: F055
+		executed++;
+		PC = 0x2B8; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2BA: 8E40
+		executed++;
+		VE = V4;
+		// 0x2BC: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x2BE:
+	B_2BE:
+		if (count - executed < 1) { PC = 0x2BE; goto exit; }
+		// 0x2BE: 3C00
+		executed++;
+		if (VC == 0x000) goto B_2C2;
+		goto B_2C0;
+
+	case 0x2C0:
+	B_2C0:
+		if (count - executed < 1) { PC = 0x2C0; goto exit; }
+		// 0x2C0: 12D2
+		executed++;
+		goto B_2D2;
+
+	case 0x2C2:
+	B_2C2:
+		if (count - executed < 1) { PC = 0x2C2; goto exit; }
+		// 0x2C2: 221C
+		executed++;
+		s.stack[SP & 0xF] = 0x2C4; SP = (SP & 0xF) + 1; goto B_21C;
+
+	case 0x2C4:
+		if (count - executed < 1) { PC = 0x2C4; goto exit; }
+		// 0x2C4: 22D8
+		executed++;
+		s.stack[SP & 0xF] = 0x2C6; SP = (SP & 0xF) + 1; goto B_2D8;
+
+	case 0x2C6:
+		if (count - executed < 1) { PC = 0x2C6; goto exit; }
+		// 0x2C6: 221C
+		executed++;
+		s.stack[SP & 0xF] = 0x2C8; SP = (SP & 0xF) + 1; goto B_21C;
+
+	case 0x2C8:
+		if (count - executed < 5) { PC = 0x2C8; goto exit; }
+		// 0x2C8: A2F8
+		executed++;
+		I = 0x2F8;
+		// 0x2CA: FD1E
+		executed++;
+		VF = (I + VD) > 0xFFF ? 1 : 0; I += VD;
+		// 0x2CC: F065
+		executed++;
+		PC = 0x2CC; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2CE: 8D00
+		executed++;
+		VD = V0;
+		// 0x2D0: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x2D2:
+	B_2D2:
+		if (count - executed < 3) { PC = 0x2D2; goto exit; }
+		// 0x2D2: 7CFF
+		executed++;
+		VC += 0x0FF;
+		// 0x2D4: CD0F
+		executed++;
+		PC = 0x2D4; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2D6: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	case 0x2D8:
+	B_2D8:
+		if (count - executed < 4) { PC = 0x2D8; goto exit; }
+		// 0x2D8: 7D01
+		executed++;
+		VD += 0x001;
+		// 0x2DA: 600F
+		executed++;
+		V0 = 0x00F;
+		// 0x2DC: 8D02
+		executed++;
+		VD &= V0;
+		// 0x2DE: ED9E
+		executed++;
+		PC = 0x2DE; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		if (PC != 0x2E0) goto dispatch;
+		goto B_2E0;
+
+	case 0x2E0:
+	B_2E0:
+		if (count - executed < 1) { PC = 0x2E0; goto exit; }
+		// 0x2E0: 12D8
+		executed++;
+		PC = 0x2D8; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_2D8;
+
+	case 0x2E2:
+	B_2E2:
+		if (count - executed < 1) { PC = 0x2E2; goto exit; }
+		// 0x2E2: EDA1
+		executed++;
+		PC = 0x2E2; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		if (PC != 0x2E4) goto dispatch;
+		goto B_2E4;
+
+	case 0x2E4:
+	B_2E4:
+		if (count - executed < 1) { PC = 0x2E4; goto exit; }
+		// 0x2E4: 12E2
+		executed++;
+		PC = 0x2E2; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_2E2;
+
+	case 0x2E6:
+		if (count - executed < 1) { PC = 0x2E6; goto exit; }
+		// 0x2E6: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	default:
+		goto exit;
+	}
+
+exit:
+	STORE();
+	return executed;
+}
+
+RecompiledProgram program = { "15PUZZLE", 2706984288u, 384, code, Run, nullptr };
+RecompiledRegistration registration(program);
+}
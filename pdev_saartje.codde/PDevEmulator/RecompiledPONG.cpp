@@ -0,0 +1,631 @@
+// Generated by Chip8Recompiler from PONG, do not edit
+#include "Chip8Recompiled.h"
+
+#define STORE() s.reg[0] = V0; s.reg[1] = V1; s.reg[2] = V2; s.reg[3] = V3; s.reg[4] = V4; s.reg[5] = V5; s.reg[6] = V6; s.reg[7] = V7; s.reg[8] = V8; s.reg[9] = V9; s.reg[10] = VA; s.reg[11] = VB; s.reg[12] = VC; s.reg[13] = VD; s.reg[14] = VE; s.reg[15] = VF; *s.regI = I; *s.stackPointer = SP; *s.regPC = PC
+#define LOAD() V0 = s.reg[0]; V1 = s.reg[1]; V2 = s.reg[2]; V3 = s.reg[3]; V4 = s.reg[4]; V5 = s.reg[5]; V6 = s.reg[6]; V7 = s.reg[7]; V8 = s.reg[8]; V9 = s.reg[9]; VA = s.reg[10]; VB = s.reg[11]; VC = s.reg[12]; VD = s.reg[13]; VE = s.reg[14]; VF = s.reg[15]; I = *s.regI; SP = *s.stackPointer; PC = *s.regPC
+
+namespace
+{
+const U32 code[128] =
+{
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x000003FF,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000
+};
+
+int Run(RecompiledState &s, int count)
+{
+	U8 V0 = s.reg[0], V1 = s.reg[1], V2 = s.reg[2], V3 = s.reg[3], V4 = s.reg[4], V5 = s.reg[5], V6 = s.reg[6], V7 = s.reg[7], V8 = s.reg[8], V9 = s.reg[9], VA = s.reg[10], VB = s.reg[11], VC = s.reg[12], VD = s.reg[13], VE = s.reg[14], VF = s.reg[15];
+	U16 I = *s.regI;
+	U16 SP = *s.stackPointer;
+	U16 PC = *s.regPC;
+	int executed = 0;
+
+dispatch:
+	switch (PC)
+	{
+	case 0x200:
+		if (count - executed < 9) { PC = 0x200; goto exit; }
+		// 0x200: 6A02
+		executed++;
+		VA = 0x002;
+		// 0x202: 6B0C
+		executed++;
+		VB = 0x00C;
+		// 0x204: 6C3F
+		executed++;
+		VC = 0x03F;
+		// 0x206: 6D0C
+		executed++;
+		VD = 0x00C;
+		// 0x208: A2EA
+		executed++;
+		I = 0x2EA;
+		// 0x20A: DAB6
+		executed++;
+		PC = 0x20A; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x20C: DCD6
+		executed++;
+		PC = 0x20C; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x20E: 6E00
+		executed++;
+		VE = 0x000;
+		// 0x210: 22D4
+		executed++;
+		s.stack[SP & 0xF] = 0x212; SP = (SP & 0xF) + 1; goto B_2D4;
+
+	case 0x212:
+		if (count - executed < 2) { PC = 0x212; goto exit; }
+		// 0x212: 6603
+		executed++;
+		V6 = 0x003;
+		// 0x214: 6802
+		executed++;
+		V8 = 0x002;
+		goto B_216;
+
+	case 0x216:
+	B_216:
+		if (count - executed < 2) { PC = 0x216; goto exit; }
+		// 0x216: 6060
+		executed++;
+		V0 = 0x060;
+		// 0x218: F015
+		executed++;
+		*s.delayTimer = V0;
+		goto B_21A;
+
+	case 0x21A:
+	B_21A:
+		if (count - executed < 2) { PC = 0x21A; goto exit; }
+		// 0x21A: F007
+		executed++;
+		V0 = *s.delayTimer;
+		// 0x21C: 3000
+		executed++;
+		if (V0 == 0x000) goto B_220;
+		goto B_21E;
+
+	case 0x21E:
+	B_21E:
+		if (count - executed < 1) { PC = 0x21E; goto exit; }
+		// 0x21E: 121A
+		executed++;
+		PC = 0x21A; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_21A;
+
+	case 0x220:
+	B_220:
+		if (count - executed < 5) { PC = 0x220; goto exit; }
+		// 0x220: C717
+		executed++;
+		PC = 0x220; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x222: 7708
+		executed++;
+		V7 += 0x008;
+		// 0x224: 69FF
+		executed++;
+		V9 = 0x0FF;
+		// 0x226: A2F0
+		executed++;
+		I = 0x2F0;
+		// 0x228: D671
+		executed++;
+		PC = 0x228; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		goto B_22A;
+
+	case 0x22A:
+	B_22A:
+		if (count - executed < 5) { PC = 0x22A; goto exit; }
+		// 0x22A: A2EA
+		executed++;
+		I = 0x2EA;
+		// 0x22C: DAB6
+		executed++;
+		PC = 0x22C; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x22E: DCD6
+		executed++;
+		PC = 0x22E; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x230: 6001
+		executed++;
+		V0 = 0x001;
+		// 0x232: E0A1
+		executed++;
+		PC = 0x232; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		if (PC != 0x234) goto dispatch;
+		goto B_234;
+
+	case 0x234:
+	B_234:
+		if (count - executed < 1) { PC = 0x234; goto exit; }
+		// 0x234: 7BFE
+		executed++;
+		VB += 0x0FE;
+		goto B_236;
+
+	case 0x236:
+	B_236:
+		if (count - executed < 2) { PC = 0x236; goto exit; }
+		// 0x236: 6004
+		executed++;
+		V0 = 0x004;
+		// 0x238: E0A1
+		executed++;
+		PC = 0x238; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		if (PC != 0x23A) goto dispatch;
+		goto B_23A;
+
+	case 0x23A:
+	B_23A:
+		if (count - executed < 1) { PC = 0x23A; goto exit; }
+		// 0x23A: 7B02
+		executed++;
+		VB += 0x002;
+		goto B_23C;
+
+	case 0x23C:
+	B_23C:
+		if (count - executed < 5) { PC = 0x23C; goto exit; }
+		// 0x23C: 601F
+		executed++;
+		V0 = 0x01F;
+		// 0x23E: 8B02
+		executed++;
+		VB &= V0;
+		// 0x240: DAB6
+		executed++;
+		PC = 0x240; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x242: 600C
+		executed++;
+		V0 = 0x00C;
+		// 0x244: E0A1
+		executed++;
+		PC = 0x244; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		if (PC != 0x246) goto dispatch;
+		goto B_246;
+
+	case 0x246:
+	B_246:
+		if (count - executed < 1) { PC = 0x246; goto exit; }
+		// 0x246: 7DFE
+		executed++;
+		VD += 0x0FE;
+		goto B_248;
+
+	case 0x248:
+	B_248:
+		if (count - executed < 2) { PC = 0x248; goto exit; }
+		// 0x248: 600D
+		executed++;
+		V0 = 0x00D;
+		// 0x24A: E0A1
+		executed++;
+		PC = 0x24A; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		if (PC != 0x24C) goto dispatch;
+		goto B_24C;
+
+	case 0x24C:
+	B_24C:
+		if (count - executed < 1) { PC = 0x24C; goto exit; }
+		// 0x24C: 7D02
+		executed++;
+		VD += 0x002;
+		goto B_24E;
+
+	case 0x24E:
+	B_24E:
+		if (count - executed < 12) { PC = 0x24E; goto exit; }
+		// 0x24E: 601F
+		executed++;
+		V0 = 0x01F;
+		// 0x250: 8D02
+		executed++;
+		VD &= V0;
+		// 0x252: DCD6
+		executed++;
+		PC = 0x252; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x254: A2F0
+		executed++;
+		I = 0x2F0;
+		// 0x256: D671
+		executed++;
+		PC = 0x256; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x258: 8684
+		executed++;
+		VF = (V6 + V8) > 255 ? 1 : 0; V6 += V8;
+		// 0x25A: 8794
+		executed++;
+		VF = (V7 + V9) > 255 ? 1 : 0; V7 += V9;
+		// 0x25C: 603F
+		executed++;
+		V0 = 0x03F;
+		// 0x25E: 8602
+		executed++;
+		V6 &= V0;
+		// 0x260: 611F
+		executed++;
+		V1 = 0x01F;
+		// 0x262: 8712
+		executed++;
+		V7 &= V1;
+		// 0x264: 4602
+		executed++;
+		if (V6 != 0x002) goto B_268;
+		goto B_266;
+
+	case 0x266:
+	B_266:
+		if (count - executed < 1) { PC = 0x266; goto exit; }
+		// 0x266: 1278
+		executed++;
+		goto B_278;
+
+	case 0x268:
+	B_268:
+		if (count - executed < 1) { PC = 0x268; goto exit; }
+		// 0x268: 463F
+		executed++;
+		if (V6 != 0x03F) goto B_26C;
+		goto B_26A;
+
+	case 0x26A:
+	B_26A:
+		if (count - executed < 1) { PC = 0x26A; goto exit; }
+		// 0x26A: 1282
+		executed++;
+		goto B_282;
+
+	case 0x26C:
+	B_26C:
+		if (count - executed < 1) { PC = 0x26C; goto exit; }
+		// 0x26C: 471F
+		executed++;
+		if (V7 != 0x01F) goto B_270;
+		goto B_26E;
+
+	case 0x26E:
+	B_26E:
+		if (count - executed < 1) { PC = 0x26E; goto exit; }
+		// 0x26E: 69FF
+		executed++;
+		V9 = 0x0FF;
+		goto B_270;
+
+	case 0x270:
+	B_270:
+		if (count - executed < 1) { PC = 0x270; goto exit; }
+		// 0x270: 4700
+		executed++;
+		if (V7 != 0x000) goto B_274;
+		goto B_272;
+
+	case 0x272:
+	B_272:
+		if (count - executed < 1) { PC = 0x272; goto exit; }
+		// 0x272: 6901
+		executed++;
+		V9 = 0x001;
+		goto B_274;
+
+	case 0x274:
+	B_274:
+		if (count - executed < 2) { PC = 0x274; goto exit; }
+		// 0x274: D671
+		executed++;
+		PC = 0x274; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x276: 122A
+		executed++;
+		PC = 0x22A; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_22A;
+
+	case 0x278:
+	B_278:
+		if (count - executed < 5) { PC = 0x278; goto exit; }
+		// 0x278: 6802
+		executed++;
+		V8 = 0x002;
+		// 0x27A: 6301
+		executed++;
+		V3 = 0x001;
+		// 0x27C: 8070
+		executed++;
+		V0 = V7;
+		// 0x27E: 80B5
+		executed++;
+		VF = VB > V0 ? 0 : 1; V0 -= VB;
+		// 0x280: 128A
+		executed++;
+		goto B_28A;
+
+	case 0x282:
+	B_282:
+		if (count - executed < 4) { PC = 0x282; goto exit; }
+		// 0x282: 68FE
+		executed++;
+		V8 = 0x0FE;
+		// 0x284: 630A
+		executed++;
+		V3 = 0x00A;
+		// 0x286: 8070
+		executed++;
+		V0 = V7;
+		// 0x288: 80D5
+		executed++;
+		VF = VD > V0 ? 0 : 1; V0 -= VD;
+		goto B_28A;
+
+	case 0x28A:
+	B_28A:
+		if (count - executed < 1) { PC = 0x28A; goto exit; }
+		// 0x28A: 3F01
+		executed++;
+		if (VF == 0x001) goto B_28E;
+		goto B_28C;
+
+	case 0x28C:
+	B_28C:
+		if (count - executed < 1) { PC = 0x28C; goto exit; }
+		// 0x28C: 12A2
+		executed++;
+		goto B_2A2;
+
+	case 0x28E:
+	B_28E:
+		if (count - executed < 3) { PC = 0x28E; goto exit; }
+		// 0x28E: 6102
+		executed++;
+		V1 = 0x002;
+		// 0x290: 8015
+		executed++;
+		VF = V1 > V0 ? 0 : 1; V0 -= V1;
+		// 0x292: 3F01
+		executed++;
+		if (VF == 0x001) goto B_296;
+		goto B_294;
+
+	case 0x294:
+	B_294:
+		if (count - executed < 1) { PC = 0x294; goto exit; }
+		// 0x294: 12BA
+		executed++;
+		goto B_2BA;
+
+	case 0x296:
+	B_296:
+		if (count - executed < 2) { PC = 0x296; goto exit; }
+		// 0x296: 8015
+		executed++;
+		VF = V1 > V0 ? 0 : 1; V0 -= V1;
+		// 0x298: 3F01
+		executed++;
+		if (VF == 0x001) goto B_29C;
+		goto B_29A;
+
+	case 0x29A:
+	B_29A:
+		if (count - executed < 1) { PC = 0x29A; goto exit; }
+		// 0x29A: 12C8
+		executed++;
+		goto B_2C8;
+
+	case 0x29C:
+	B_29C:
+		if (count - executed < 2) { PC = 0x29C; goto exit; }
+		// 0x29C: 8015
+		executed++;
+		VF = V1 > V0 ? 0 : 1; V0 -= V1;
+		// 0x29E: 3F01
+		executed++;
+		if (VF == 0x001) goto B_2A2;
+		goto B_2A0;
+
+	case 0x2A0:
+	B_2A0:
+		if (count - executed < 1) { PC = 0x2A0; goto exit; }
+		// 0x2A0: 12C2
+		executed++;
+		goto B_2C2;
+
+	case 0x2A2:
+	B_2A2:
+		if (count - executed < 3) { PC = 0x2A2; goto exit; }
+		// 0x2A2: 6020
+		executed++;
+		V0 = 0x020;
+		// 0x2A4: F018
+		executed++;
+		*s.soundTimer = V0;
+		// 0x2A6: 22D4
+		executed++;
+		s.stack[SP & 0xF] = 0x2A8; SP = (SP & 0xF) + 1; goto B_2D4;
+
+	case 0x2A8:
+		if (count - executed < 2) { PC = 0x2A8; goto exit; }
+		// 0x2A8: 8E34
+		executed++;
+		VF = (VE + V3) > 255 ? 1 : 0; VE += V3;
+		// 0x2AA: 22D4
+		executed++;
+		s.stack[SP & 0xF] = 0x2AC; SP = (SP & 0xF) + 1; goto B_2D4;
+
+	case 0x2AC:
+		if (count - executed < 2) { PC = 0x2AC; goto exit; }
+		// 0x2AC: 663E
+		executed++;
+		V6 = 0x03E;
+		// 0x2AE: 3301
+		executed++;
+		if (V3 == 0x001) goto B_2B2;
+		goto B_2B0;
+
+	case 0x2B0:
+	B_2B0:
+		if (count - executed < 1) { PC = 0x2B0; goto exit; }
+		// 0x2B0: 6603
+		executed++;
+		V6 = 0x003;
+		goto B_2B2;
+
+	case 0x2B2:
+	B_2B2:
+		if (count - executed < 2) { PC = 0x2B2; goto exit; }
+		// 0x2B2: 68FE
+		executed++;
+		V8 = 0x0FE;
+		// 0x2B4: 3301
+		executed++;
+		if (V3 == 0x001) goto B_2B8;
+		goto B_2B6;
+
+	case 0x2B6:
+	B_2B6:
+		if (count - executed < 1) { PC = 0x2B6; goto exit; }
+		// 0x2B6: 6802
+		executed++;
+		V8 = 0x002;
+		goto B_2B8;
+
+	case 0x2B8:
+	B_2B8:
+		if (count - executed < 1) { PC = 0x2B8; goto exit; }
+		// 0x2B8: 1216
+		executed++;
+		PC = 0x216; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_216;
+
+	case 0x2BA:
+	B_2BA:
+		if (count - executed < 2) { PC = 0x2BA; goto exit; }
+		// 0x2BA: 79FF
+		executed++;
+		V9 += 0x0FF;
+		// 0x2BC: 49FE
+		executed++;
+		if (V9 != 0x0FE) goto B_2C0;
+		goto B_2BE;
+
+	case 0x2BE:
+	B_2BE:
+		if (count - executed < 1) { PC = 0x2BE; goto exit; }
+		// 0x2BE: 69FF
+		executed++;
+		V9 = 0x0FF;
+		goto B_2C0;
+
+	case 0x2C0:
+	B_2C0:
+		if (count - executed < 1) { PC = 0x2C0; goto exit; }
+		// 0x2C0: 12C8
+		executed++;
+		goto B_2C8;
+
+	case 0x2C2:
+	B_2C2:
+		if (count - executed < 2) { PC = 0x2C2; goto exit; }
+		// 0x2C2: 7901
+		executed++;
+		V9 += 0x001;
+		// 0x2C4: 4902
+		executed++;
+		if (V9 != 0x002) goto B_2C8;
+		goto B_2C6;
+
+	case 0x2C6:
+	B_2C6:
+		if (count - executed < 1) { PC = 0x2C6; goto exit; }
+		// 0x2C6: 6901
+		executed++;
+		V9 = 0x001;
+		goto B_2C8;
+
+	case 0x2C8:
+	B_2C8:
+		if (count - executed < 4) { PC = 0x2C8; goto exit; }
+		// 0x2C8: 6004
+		executed++;
+		V0 = 0x004;
+		// 0x2CA: F018
+		executed++;
+		*s.soundTimer = V0;
+		// 0x2CC: 7601
+		executed++;
+		V6 += 0x001;
+		// 0x2CE: 4640
+		executed++;
+		if (V6 != 0x040) goto B_2D2;
+		goto B_2D0;
+
+	case 0x2D0:
+	B_2D0:
+		if (count - executed < 1) { PC = 0x2D0; goto exit; }
+		// 0x2D0: 76FE
+		executed++;
+		V6 += 0x0FE;
+		goto B_2D2;
+
+	case 0x2D2:
+	B_2D2:
+		if (count - executed < 1) { PC = 0x2D2; goto exit; }
+		// 0x2D2: 126C
+		executed++;
+		PC = 0x26C; STORE(); executed = count - Chip8Recompiled::Loop(s, count - executed); goto B_26C;
+
+	case 0x2D4:
+	B_2D4:
+		if (count - executed < 11) { PC = 0x2D4; goto exit; }
+		// 0x2D4: A2F2
+		executed++;
+		I = 0x2F2;
+		// 0x2D6: FE33
+		executed++;
+		PC = 0x2D6; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2D8: F265
+		executed++;
+		PC = 0x2D8; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2DA: F129
+		executed++;
+		I = V1 * 5;
+		// 0x2DC: 6414
+		executed++;
+		V4 = 0x014;
+		// 0x2DE: 6500
+		executed++;
+		V5 = 0x000;
+		// 0x2E0: D455
+		executed++;
+		PC = 0x2E0; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2E2: 7415
+		executed++;
+		V4 += 0x015;
+		// 0x2E4: F229
+		executed++;
+		I = V2 * 5;
+		// 0x2E6: D455
+		executed++;
+		PC = 0x2E6; STORE(); if (!Chip8Recompiled::Step(s)) { LOAD(); goto exit; } LOAD();
+		// 0x2E8: 00EE
+		executed++;
+		SP = (SP - 1) & 0xF; PC = s.stack[SP]; goto dispatch;
+
+	default:
+		goto exit;
+	}
+
+exit:
+	STORE();
+	return executed;
+}
+
+RecompiledProgram program = { "PONG", 820196514u, 246, code, Run, nullptr };
+RecompiledRegistration registration(program);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free queue from one producer thread to one consumer thread
+// Capacity must be a power of two; Push() fails instead of waiting when the queue is full
+template <class T, unsigned int Capacity>
+class SpscQueue
+{
+public:
+	bool Push(const T &item)
+	{
+		unsigned int t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+		items[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(T &item)
+	{
+		unsigned int h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		item = items[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	T items[Capacity];
+	std::atomic<unsigned int> head{ 0 }; // Next item to pop, written by the consumer
+	std::atomic<unsigned int> tail{ 0 }; // Next free slot, written by the producer
+};
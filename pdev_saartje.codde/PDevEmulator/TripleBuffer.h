@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free triple buffer between one producer thread and one consumer thread
+// The producer fills Back() and publishes it, the consumer picks up the latest published buffer with Update() and reads Front()
+// Neither side ever waits for the other; buffers the consumer did not get to in time are simply skipped
+template <class T>
+class TripleBuffer
+{
+public:
+	T &Back() { return buffers[back]; }
+
+	void Publish()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Returns false when nothing was published since the last call, Front() is then unchanged
+	bool Update()
+	{
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	const T &Front() const { return buffers[front]; }
+
+private:
+	static const int INDEX = 3; // Index of the buffer in the middle slot
+	static const int FRESH = 4; // Set when the middle buffer was published and not picked up yet
+
+	T buffers[3] = {};
+	int back = 0; // Only used by the producer
+	int front = 1; // Only used by the consumer
+	std::atomic<int> middle{ 2 };
+};
@@ -1,6 +1,17 @@
 #include "Chip8.h"
+#include "Chip8Audio.h"
+#include "Chip8Thread.h"
+#include "Chip8Trace.h"
+#include <cstdlib>
+#include <cstring>
+
+#include <glad\glad.h>
+#define GLFW_INCLUDE_GLU
+#include <GLFW/glfw3.h>
 
 Chip8 emulator;
+Chip8Audio audio;
+Chip8Thread emulation(emulator, audio);
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
@@ -8,7 +19,12 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 	{
 		glfwSetWindowShouldClose(window, GL_TRUE);
 	}
-	emulator.Keypress(key, action);
+	if (key == GLFW_KEY_BACKSPACE && action != GLFW_REPEAT)
+	{
+		emulation.SetRewinding(action == GLFW_PRESS); // Rewinds while held
+		return;
+	}
+	emulation.Keypress(key, action);
 }
 
 void drop_callback(GLFWwindow* window, int count, const char** paths)
@@ -20,6 +36,8 @@ void drop_callback(GLFWwindow* window, int count, const char** paths)
 		path.append(paths[i]);
 	}
 
+	emulation.Stop();
+	emulation.ClearRewind();
 	emulator.Initialize();
 	emulator.LoadFile(*paths);
 
@@ -27,6 +45,10 @@ void drop_callback(GLFWwindow* window, int count, const char** paths)
 	{
 		glfwSetWindowShouldClose(window, 1);
 	}
+	else
+	{
+		emulation.Start();
+	}
 }
 
 // Shader sources
@@ -44,14 +66,91 @@ const GLchar* fragmentSource =
 "#version 150 core\n"
 "in vec2 Texcoord;"
 "out vec4 outColor;"
-"uniform sampler2D texGraphics;"
+"uniform usampler2D texGraphics;"
+"uniform vec3 palette[2];"
 "void main() {"
-"   outColor=texture(texGraphics, Texcoord);"
+"   ivec2 pixel = min(ivec2(Texcoord * vec2(64.0, 32.0)), ivec2(63, 31));"
+// Every row is a little-endian 64-bit word with column 0 in its most significant bit, so in the last byte
+"   uint pixels = texelFetch(texGraphics, ivec2(7 - pixel.x / 8, pixel.y), 0).r;"
+"   outColor = vec4(palette[int((pixels >> uint(7 - pixel.x % 8)) & 1u)], 1.0);"
 "}";
 
-int main()
+int main(int argc, char *argv[])
 {
+	AudioSink *audioSink = nullptr;
+	const char *tracePath = nullptr;
+	int runAhead = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		// --core switch|threaded|jit|static selects the execution core
+		if (strcmp(argv[i], "--core") == 0 && i + 1 < argc)
+		{
+			++i;
+			if (strcmp(argv[i], "threaded") == 0) emulator.SetCore(Chip8::CORE_THREADED);
+			else if (strcmp(argv[i], "jit") == 0) emulator.SetCore(Chip8::CORE_JIT);
+			else if (strcmp(argv[i], "static") == 0) emulator.SetCore(Chip8::CORE_STATIC);
+			else emulator.SetCore(Chip8::CORE_SWITCH);
+		}
+		// --quirks default|connect4|blitz|vip overrides the profile picked from the ROM checksum
+		else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc)
+		{
+			++i;
+			if (strcmp(argv[i], "connect4") == 0) emulator.SetQuirkProfile(Chip8::QUIRKS_CONNECT4);
+			else if (strcmp(argv[i], "blitz") == 0) emulator.SetQuirkProfile(Chip8::QUIRKS_BLITZ);
+			else if (strcmp(argv[i], "vip") == 0) emulator.SetQuirkProfile(Chip8::QUIRKS_VIP);
+			else emulator.SetQuirkProfile(Chip8::QUIRKS_DEFAULT);
+		}
+		// --ips N|unlimited sets the instructions per second, --turbo runs as fast as possible
+		else if (strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+		{
+			++i;
+			if (strcmp(argv[i], "unlimited") == 0) emulation.Scheduler().SetInstructionsPerSecond(Chip8Scheduler::UNLIMITED);
+			else emulation.Scheduler().SetInstructionsPerSecond(atoi(argv[i]));
+		}
+		else if (strcmp(argv[i], "--turbo") == 0)
+		{
+			emulation.Scheduler().SetTurbo(true);
+		}
+		// --audio system|null|wav <file> selects where the sound goes
+		else if (strcmp(argv[i], "--audio") == 0 && i + 1 < argc)
+		{
+			++i;
+			if (strcmp(argv[i], "null") == 0) audioSink = new NullAudioSink();
+			else if (strcmp(argv[i], "wav") == 0 && i + 1 < argc) audioSink = new WavAudioSink(argv[++i]);
+		}
+		// --rewind <MB> sets the size of the rewind history, 0 turns it off
+		else if (strcmp(argv[i], "--rewind") == 0 && i + 1 < argc)
+		{
+			++i;
+			char *end;
+			unsigned long megabytes = strtoul(argv[i], &end, 10);
+			if (argv[i][0] < '0' || argv[i][0] > '9' || *end != 0 || megabytes > (Chip8Rewind::MAX_CAPACITY >> 20))
+			{
+				std::cout << "--rewind takes 0 to " << (Chip8Rewind::MAX_CAPACITY >> 20) << " MB, keeping the default" << std::endl;
+			}
+			else emulation.SetRewindCapacity((size_t)megabytes << 20);
+		}
+		// --run-ahead N shows the frame N frames ahead, so that key presses show up N frames earlier
+		else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc)
+		{
+			runAhead = atoi(argv[++i]);
+			emulation.SetRunAhead(runAhead);
+		}
+		// --trace <file> writes the phases of every frame as Chrome trace-event JSON on exit
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+			Chip8Trace::Start();
+			Chip8Trace::SetThreadName("Render");
+		}
+	}
+
 	if (!emulator.Initialize()) return 0;
+
+	if (!audio.Start(audioSink ? audioSink : CreateSystemAudioSink()))
+	{
+		std::cout << "No sound device, continuing without sound" << std::endl;
+	}
 	
 	if (!glfwInit())
 		exit(EXIT_FAILURE);
@@ -138,6 +237,14 @@ int main()
 	glEnableVertexAttribArray(textureAttribute);
 	glVertexAttribPointer(textureAttribute, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), reinterpret_cast<void*>(2 * sizeof(GLfloat)));
 
+	// Colours of pixels that are off and on
+	GLfloat palette[] =
+	{
+		0.0f, 0.0f, 0.0f,
+		1.0f, 1.0f, 1.0f
+	};
+	glUniform3fv(glGetUniformLocation(shaderProgram, "palette"), 2, palette);
+
 	// Load texture
 	GLuint texture;
 	glGenTextures(1, &texture);
@@ -155,44 +262,127 @@ int main()
 	glfwSetDropCallback(window, drop_callback);
 
 	glBindTexture(GL_TEXTURE_2D, texture);
+	U64 shownRows[32] = { 0 }; // Display rows currently in the texture
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, 8, 32, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, shownRows); // The packed display, 8 bytes per row
+
+	// Ring of pixel buffer objects the display is streamed through
+	// glTexSubImage2D then copies from a buffer the driver owns instead of from shownRows,
+	// and a buffer is only written again once the fence placed after its last upload has passed
+	const int pixelBufferCount = 3;
+	GLuint pixelBuffers[pixelBufferCount];
+	GLsync pixelBufferFences[pixelBufferCount] = { 0 };
+	int pixelBufferIndex = 0;
+
+	glGenBuffers(pixelBufferCount, pixelBuffers);
+	for (int i = 0; i < pixelBufferCount; i++)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeof(shownRows), NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	emulation.Start();
 
 	while (!glfwWindowShouldClose(window))
 	{
+		Chip8Trace::Scope frameTrace("Frame");
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		for (size_t i = 0; i < 8; i++) // 1 tick is 60 hz, default == 0.5khz, 500/60 = 8,xx
+		// Pick up the latest frame of the emulation thread and find the rows that differ from the ones shown
+		Chip8Trace::Scope uploadTrace("Upload");
+		U32 dirtyRows = 0;
+		if (emulation.Frames().Update())
 		{
-			emulator.Tick();
+			const Chip8Thread::Frame &frame = emulation.Frames().Front();
+			for (int row = 0; row < 32; row++)
+			{
+				if (frame.display[row] != shownRows[row])
+				{
+					shownRows[row] = frame.display[row];
+					dirtyRows |= 1u << row;
+				}
+			}
 		}
 
-		if (emulator.delayTimer > 0)
+		// Upload only the runs of rows that changed, nothing at all when the display did not change
+		if (dirtyRows != 0)
 		{
-			emulator.delayTimer--;
-		}
+			GLsync &fence = pixelBufferFences[pixelBufferIndex];
+			if (fence)
+			{
+				Chip8Trace::Scope trace("Fence wait");
+				glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED); // Normally signalled frames ago
+				glDeleteSync(fence);
+				fence = 0;
+			}
 
-		if (emulator.soundTimer > 0)
-		{
-			if (emulator.soundTimer > 1)
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[pixelBufferIndex]);
+			void *pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, sizeof(shownRows), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (pixels)
 			{
-				Beep(523, 50 * emulator.soundTimer);
-				emulator.soundTimer = 0;
+				memcpy(pixels, shownRows, sizeof(shownRows));
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+				for (int row = 0; row < 32;)
+				{
+					if ((dirtyRows & (1u << row)) == 0)
+					{
+						++row;
+						continue;
+					}
+					int first = row;
+					while (row < 32 && (dirtyRows & (1u << row)) != 0)
+					{
+						++row;
+					}
+					// The last argument is an offset into the bound pixel buffer
+					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, 8, row - first, GL_RED_INTEGER, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(first * sizeof(U64)));
+				}
+				fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 			}
 			else
 			{
-				Beep(523, 50);
-				--emulator.soundTimer;
+				// Could not map the buffer, upload the whole display directly
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 8, 32, GL_RED_INTEGER, GL_UNSIGNED_BYTE, shownRows);
 			}
+			pixelBufferIndex = (pixelBufferIndex + 1) % pixelBufferCount;
 		}
+		uploadTrace.End();
 
-		emulator.Draw();
+		{
+			Chip8Trace::Scope trace("glDrawElements");
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+		{
+			Chip8Trace::Scope trace("glfwSwapBuffers");
+			glfwSwapBuffers(window);
+		}
+		{
+			Chip8Trace::Scope trace("glfwPollEvents");
+			glfwPollEvents();
+		}
+	}
 
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 64, 32, 0, GL_RGB, GL_UNSIGNED_BYTE, &emulator.textureVector[0]);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+	emulation.Stop();
+	audio.Stop();
 
-		glfwSwapBuffers(window);
-		
-		glfwPollEvents();
+	if (runAhead > 0)
+	{
+		std::cout << "Run-ahead of " << runAhead << " frames: " << emulation.GetRunAheadMicroseconds() << " us per frame" << std::endl;
+	}
+
+	if (tracePath && !Chip8Trace::Write(tracePath))
+	{
+		std::cout << "Could not write the trace to " << tracePath << std::endl;
+	}
+
+	for (int i = 0; i < pixelBufferCount; i++)
+	{
+		if (pixelBufferFences[i]) glDeleteSync(pixelBufferFences[i]);
 	}
+	glDeleteBuffers(pixelBufferCount, pixelBuffers);
 
 	glfwDestroyWindow(window);
 	glfwTerminate();